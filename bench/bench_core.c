@@ -0,0 +1,266 @@
+/*
+ * bench_core.c — Benchmarks for z-core primitives.
+ *
+ * Build and run with `make -C bench bench-core`. Results go to stdout in
+ * one table so runs before and after a z-core bump can be diffed.
+ */
+
+#define ZARENA_IMPLEMENTATION
+#include "zarena.h"
+#define ZSLAB_IMPLEMENTATION
+#include "zslab.h"
+#define ZHASH_IMPLEMENTATION
+#include "zhash.h"
+#define ZSIMD_IMPLEMENTATION
+#include "zsimd.h"
+#define ZVMEM_IMPLEMENTATION
+#include "zvmem.h"
+#define ZBENCH_IMPLEMENTATION
+#include "zbench.h"
+
+// Growth strategies: fill an int vector of `n` elements through Z_REALLOC.
+
+typedef enum { GROW_2X, GROW_1_5X, GROW_POLICY } GrowKind;
+
+typedef struct {
+    GrowKind kind;
+    size_t n;
+} GrowCtx;
+
+static void bench_growth(void *ctx, uint64_t iters)
+{
+    const GrowCtx *g = (const GrowCtx *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        int *data = NULL;
+        size_t len = 0, cap = 0;
+        for (size_t i = 0; i < g->n; i++)
+        {
+            if (len == cap)
+            {
+                size_t next;
+                switch (g->kind)
+                {
+                    case GROW_2X:   next = cap ? cap * 2 : 32; break;
+                    case GROW_1_5X: next = cap ? cap + cap / 2 : 32; break;
+                    default:        next = z_grow_capacity(cap, len + 1, sizeof(int), 0); break;
+                }
+                int *nd = (int *)Z_REALLOC(data, next * sizeof(int));
+                if (!nd)
+                {
+                    Z_FREE(data);
+                    return;
+                }
+                data = nd;
+                cap = (GROW_POLICY == g->kind) ? z_usable_capacity(data, next, sizeof(int)) : next;
+            }
+            data[len++] = (int)i;
+        }
+        Z_BENCH_KEEP(data);
+        Z_FREE(data);
+    }
+}
+
+static void bench_growth_vbuf(void *ctx, uint64_t iters)
+{
+    const GrowCtx *g = (const GrowCtx *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        z_vbuf b;
+        if (Z_OK != z_vbuf_init(&b, g->n * sizeof(int)))
+        {
+            return;
+        }
+        for (size_t i = 0; i < g->n; i++)
+        {
+            if (Z_OK != z_vbuf_ensure(&b, (i + 1) * sizeof(int)))
+            {
+                break;
+            }
+            ((int *)b.data)[i] = (int)i;
+        }
+        Z_BENCH_KEEP(b.data);
+        z_vbuf_free(&b);
+    }
+}
+
+// Allocators: a node-container lifetime (allocate `NODES`, then release all).
+
+#define NODES 4096
+#define NODE_SIZE 48
+
+static void bench_nodes_malloc(void *ctx, uint64_t iters)
+{
+    void **slots = (void **)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        for (size_t i = 0; i < NODES; i++)
+        {
+            slots[i] = Z_MALLOC(NODE_SIZE);
+            Z_BENCH_KEEP(slots[i]);
+        }
+        for (size_t i = 0; i < NODES; i++)
+        {
+            Z_FREE(slots[i]);
+        }
+    }
+}
+
+static void bench_nodes_slab(void *ctx, uint64_t iters)
+{
+    void **slots = (void **)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        for (size_t i = 0; i < NODES; i++)
+        {
+            slots[i] = z_slab_alloc(NODE_SIZE);
+            Z_BENCH_KEEP(slots[i]);
+        }
+        for (size_t i = 0; i < NODES; i++)
+        {
+            z_slab_free(slots[i]);
+        }
+    }
+}
+
+static void bench_nodes_arena(void *ctx, uint64_t iters)
+{
+    z_arena *a = (z_arena *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        for (size_t i = 0; i < NODES; i++)
+        {
+            void *p = z_arena_alloc(a, NODE_SIZE);
+            Z_BENCH_KEEP(p);
+        }
+        z_arena_reset(a);
+    }
+}
+
+// Hashing.
+
+typedef struct {
+    const char *data;
+    size_t len;
+} BufCtx;
+
+static void bench_hash_bytes(void *ctx, uint64_t iters)
+{
+    const BufCtx *b = (const BufCtx *)ctx;
+    uint64_t seed = z_hash_seed();
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        uint64_t h = z_hash_bytes(b->data, b->len, seed);
+        Z_BENCH_KEEP(h);
+    }
+}
+
+static void bench_hash_u64(void *ctx, uint64_t iters)
+{
+    (void)ctx;
+    uint64_t seed = z_hash_seed();
+    uint64_t acc = 0;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        acc += z_hash_u64(it, seed);
+    }
+    Z_BENCH_KEEP(acc);
+}
+
+// Byte search.
+
+static void bench_memchr2_naive(void *ctx, uint64_t iters)
+{
+    const BufCtx *b = (const BufCtx *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        const char *hit = NULL;
+        for (size_t i = 0; i < b->len; i++)
+        {
+            if ('(' == b->data[i] || '{' == b->data[i])
+            {
+                hit = b->data + i;
+                break;
+            }
+        }
+        Z_BENCH_KEEP(hit);
+    }
+}
+
+static void bench_memchr2_simd(void *ctx, uint64_t iters)
+{
+    const BufCtx *b = (const BufCtx *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        const char *hit = z_memchr2(b->data, b->len, '(', '{');
+        Z_BENCH_KEEP(hit);
+    }
+}
+
+static void bench_memmem_simd(void *ctx, uint64_t iters)
+{
+    const BufCtx *b = (const BufCtx *)ctx;
+    for (uint64_t it = 0; it < iters; it++)
+    {
+        const char *hit = z_memmem(b->data, b->len, "@endgroup", 9);
+        Z_BENCH_KEEP(hit);
+    }
+}
+
+static void run(const char *name, z_bench_fn fn, void *ctx, uint64_t bytes)
+{
+    z_bench_config cfg = Z_BENCH_DEFAULTS;
+    cfg.bytes_per_iter = bytes;
+    z_bench_result r = z_bench_run(name, fn, ctx, &cfg);
+    z_bench_print(stdout, &r);
+}
+
+int main(void)
+{
+    z_bench_print_header(stdout);
+
+    size_t sizes[] = { 1000, 100000, 4000000 };
+    const char *grow_names[][3] = {
+        { "growth/2x/1k",     "growth/2x/100k",     "growth/2x/4M" },
+        { "growth/1.5x/1k",   "growth/1.5x/100k",   "growth/1.5x/4M" },
+        { "growth/policy/1k", "growth/policy/100k", "growth/policy/4M" },
+    };
+    for (int k = 0; k < 3; k++)
+    {
+        for (int s = 0; s < 3; s++)
+        {
+            GrowCtx g = { (GrowKind)k, sizes[s] };
+            run(grow_names[k][s], bench_growth, &g, sizes[s] * sizeof(int));
+        }
+    }
+    GrowCtx gv = { GROW_POLICY, sizes[2] };
+    run("growth/vbuf/4M", bench_growth_vbuf, &gv, sizes[2] * sizeof(int));
+
+    void **slots = (void **)malloc(NODES * sizeof(void *));
+    z_arena arena = z_arena_init(0, NULL);
+    run("alloc/nodes/malloc", bench_nodes_malloc, slots, 0);
+    run("alloc/nodes/slab", bench_nodes_slab, slots, 0);
+    run("alloc/nodes/arena", bench_nodes_arena, &arena, 0);
+    z_arena_free(&arena);
+    free(slots);
+
+    size_t big = (size_t)1 << 20;
+    char *text = (char *)malloc(big);
+    for (size_t i = 0; i < big; i++)
+    {
+        text[i] = "abcdefghij klmnop;\n"[i % 19];
+    }
+    BufCtx key16 = { text, 16 };
+    BufCtx page = { text, 4096 };
+    BufCtx whole = { text, big };
+    run("hash/bytes/16", bench_hash_bytes, &key16, 16);
+    run("hash/bytes/4k", bench_hash_bytes, &page, 4096);
+    run("hash/u64", bench_hash_u64, NULL, 0);
+
+    printf("# simd isa: %s\n", z_simd_isa());
+    run("search/memchr2/naive/1M", bench_memchr2_naive, &whole, big);
+    run("search/memchr2/simd/1M", bench_memchr2_simd, &whole, big);
+    run("search/memmem/simd/1M", bench_memmem_simd, &whole, big);
+    free(text);
+    return 0;
+}
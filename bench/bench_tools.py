@@ -0,0 +1,154 @@
+import os
+import io
+import sys
+import time
+import shutil
+import argparse
+import tempfile
+import contextlib
+import subprocess
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, ROOT)
+
+import zscanner
+import zbundler
+
+def synthetic_source(index, types_per_file):
+    """
+    A translation unit declaring a handful of containers, padded with
+    ordinary code so the scanner has something to skip over.
+    """
+    out = [f"#include \"z_registry.h\"\n\n"]
+    for t in range(types_per_file):
+        name = f"T{index}_{t}"
+        out.append(f"typedef struct {{ int a; float b; }} {name};\n")
+        out.append(f"DEFINE_VEC_TYPE({name}, Vec{name})\n")
+        out.append(f"DEFINE_LIST_TYPE({name} *, List{name})\n")
+        out.append(f"DEFINE_MAP_TYPE(int, {name}, Map{name})\n")
+    for fn in range(40):
+        out.append(f"static int helper_{index}_{fn}(int x)\n{{\n    return x * {fn} + {index};\n}}\n\n")
+    return "".join(out)
+
+def synthetic_header(target_bytes):
+    """
+    A zdoc-annotated header of roughly `target_bytes`, mixing groups,
+    structs, enums, examples, sections, alerts, manual tables and plain
+    declarations, so every common directive goes through the lexer.
+    """
+    out = ["/// @toc\n"]
+    size = 0
+    n = 0
+    while size < target_bytes:
+        chunk = (
+            f"/// @group Module {n}\n"
+            f"/// Creates a new widget.\n"
+            f"/// @param cap Initial capacity.\n"
+            f"/// @return A widget handle.\n"
+            f"widget_{n} *widget_{n}_new(size_t cap);\n\n"
+            f"/// Destroys a widget.\n"
+            f"/// @example c\n"
+            f"/// widget_{n}_free(w);\n"
+            f"/// @endexample\n"
+            f"void widget_{n}_free(widget_{n} *w);\n"
+            f"/// @endgroup\n\n"
+            f"/// @struct widget_{n}\n"
+            f"typedef struct {{\n"
+            f"    size_t len; //< Elements in use.\n"
+            f"    size_t cap; //< Elements allocated.\n"
+            f"}} widget_{n};\n\n"
+            f"/// @section Notes {n}\n"
+            f"/// Widgets are not thread-safe.\n"
+            f"/// @note Share them through a lock.\n"
+            f"/// @warning Never free a widget twice.\n"
+            f"/// @subsection Limits\n"
+            f"/// @columns Limit | Value\n"
+            f"/// @table Widget {n} limits\n"
+            f"/// @row Capacity | 2^32\n"
+            f"/// @row Name length | 255\n"
+            f"/// @todo Lift the name limit.\n\n"
+            f"/// @enum mode_{n}\n"
+            f"typedef enum {{\n"
+            f"    MODE_{n}_A, //< First.\n"
+            f"    MODE_{n}_B, //< Second.\n"
+            f"}} mode_{n};\n\n"
+        )
+        out.append(chunk)
+        size += len(chunk)
+        n += 1
+    return "".join(out)
+
+def measure(fn, runs):
+    times = []
+    for _ in range(runs):
+        t0 = time.perf_counter()
+        with contextlib.redirect_stdout(io.StringIO()):
+            fn()
+        times.append((time.perf_counter() - t0) * 1e3)
+    times.sort()
+    return times[len(times) // 2], times[(len(times) * 99) // 100], times[0]
+
+def report(name, stats, mb=None):
+    median, p99, best = stats
+    rate = f"{mb / (median / 1e3):10.1f}" if mb else f"{'-':>10}"
+    print(f"{name:<40} {median:12.2f} {p99:12.2f} {best:12.2f} {rate}")
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the z-core build tools.")
+    parser.add_argument("--files", type=int, default=400, help="Synthetic source files to scan")
+    parser.add_argument("--types", type=int, default=4, help="Container definitions per file")
+    parser.add_argument("--header-mb", type=float, default=4.0, help="Size of the synthetic zdoc header")
+    parser.add_argument("--runs", type=int, default=11, help="Timed runs per benchmark")
+    parser.add_argument("--zdoc-gen", default=None, help="Path to a built zdoc_gen binary")
+    args = parser.parse_args()
+
+    work = tempfile.mkdtemp(prefix="zbench_")
+    try:
+        src = os.path.join(work, "src")
+        os.makedirs(src)
+        total = 0
+        for i in range(args.files):
+            text = synthetic_source(i, args.types)
+            total += len(text)
+            with open(os.path.join(src, f"unit_{i}.c"), "w", encoding="utf-8") as f:
+                f.write(text)
+        src_mb = total / (1 << 20)
+        registry_path = os.path.join(work, "z_registry.h")
+
+        print(f"{'benchmark':<40} {'median ms':>12} {'p99 ms':>12} {'min ms':>12} {'MB/s':>10}")
+
+        report(f"zscanner/scan/{args.files}", measure(
+            lambda: zscanner.scan_directory(src, registry_path), args.runs), src_mb)
+
+        cache_path = os.path.join(work, "scan.cache")
+        with contextlib.redirect_stdout(io.StringIO()):
+            zscanner.scan_directory(src, registry_path, cache_path=cache_path)
+        report(f"zscanner/scan-cached/{args.files}", measure(
+            lambda: zscanner.scan_directory(src, registry_path, cache_path=cache_path), args.runs))
+
+        with contextlib.redirect_stdout(io.StringIO()):
+            reg = zscanner.scan_directory(src, registry_path)
+        report("zscanner/generate", measure(
+            lambda: zscanner.generate_header(reg, registry_path), args.runs))
+
+        common = os.path.join(ROOT, "zcommon.h")
+        bundled = os.path.join(work, "bundle.h")
+        for lib in ("zarena.h", "zslab.h", "zsimd.h"):
+            report(f"zbundler/{lib}", measure(
+                lambda lib=lib: zbundler.create_bundle(os.path.join(ROOT, lib), common, bundled), args.runs))
+
+        if args.zdoc_gen:
+            header = os.path.join(work, "big.h")
+            text = synthetic_header(int(args.header_mb * (1 << 20)))
+            with open(header, "w", encoding="utf-8") as f:
+                f.write(text)
+            out = os.path.join(work, "API.md")
+            cmd = [args.zdoc_gen, header, out]
+            report(f"zdoc_gen/{args.header_mb:g}MB", measure(
+                lambda: subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL), args.runs),
+                len(text) / (1 << 20))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+if __name__ == "__main__":
+    main()
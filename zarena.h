@@ -0,0 +1,426 @@
+/*
+ * zarena.h — Chunked bump allocator for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Allocations are a pointer bump inside a chunk; nothing is freed per
+ * element. Memory is released all at once with z_arena_reset/z_arena_free,
+ * or back to a saved position with marks and scoped rewinds.
+ *
+ * Define ZARENA_IMPLEMENTATION in exactly one translation unit before
+ * including this header.
+ *
+ * Backing the global Z_MALLOC family with the thread-local scratch arena
+ * (chunks come from ZARENA_CHUNK_MALLOC, not Z_MALLOC, so this is safe).
+ * zarena.h declares the z_scratch_* entry points before pulling in
+ * zcommon.h, so it must be the first ZDK header in the translation unit:
+ *
+ *   #define Z_MALLOC(sz)     z_scratch_malloc(sz)
+ *   #define Z_CALLOC(n, sz)  z_scratch_calloc(n, sz)
+ *   #define Z_REALLOC(p, sz) z_scratch_realloc(p, sz)
+ *   #define Z_FREE(p)        ((void)(p))
+ *   #include "zarena.h"
+ *
+ * Notes:
+ * - Without thread-local storage (see Z_HAS_THREAD_LOCAL) the scratch arena
+ *   is a single global and is only safe from a single thread.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZARENA_H
+#define ZARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scratch-arena malloc family; declared ahead of zcommon.h so Z_MALLOC can name them.
+void *z_scratch_malloc(size_t size);
+void *z_scratch_calloc(size_t n, size_t size);
+void *z_scratch_realloc(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "zcommon.h"
+
+// Where chunks come from when the arena has no parent z_allocator.
+#ifndef ZARENA_CHUNK_MALLOC
+#   define ZARENA_CHUNK_MALLOC(sz)  malloc(sz)
+#   define ZARENA_CHUNK_FREE(p)     free(p)
+#endif
+
+// Default usable bytes per chunk.
+#ifndef ZARENA_DEFAULT_CHUNK
+#   define ZARENA_DEFAULT_CHUNK (64 * 1024)
+#endif
+
+// Pass as `old_size` to z_arena_realloc when the caller does not know it.
+#define Z_ARENA_UNKNOWN_SIZE ((size_t)-1)
+
+typedef struct z_arena_chunk z_arena_chunk;
+
+struct z_arena_chunk {
+    z_arena_chunk *prev;
+    char *top;   // Next free byte.
+    char *end;   // One past the last usable byte.
+};
+
+typedef struct z_arena {
+    z_arena_chunk *head;          // Chunk currently being bumped.
+    z_arena_chunk *spare;         // One retained chunk to avoid malloc churn on rewind.
+    char *last;                   // Most recent allocation (in-place realloc).
+    size_t chunk_size;
+    const z_allocator *parent;    // NULL: ZARENA_CHUNK_MALLOC/FREE.
+} z_arena;
+
+typedef struct z_arena_mark {
+    z_arena *arena;
+    z_arena_chunk *chunk;
+    char *top;
+    char *last;
+} z_arena_mark;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Slow path: opens a new chunk big enough for the request.
+void *z_arena_alloc_slow_(z_arena *a, size_t align, size_t size);
+
+void *z_arena_realloc(z_arena *a, void *ptr, size_t old_size, size_t new_size);
+void  z_arena_rewind(z_arena_mark m);
+void  z_arena_reset(z_arena *a);
+void  z_arena_free(z_arena *a);
+
+// Thread-local scratch arena (created lazily with default settings).
+z_arena *z_arena_scratch(void);
+
+// Releases the calling thread's scratch chunks. Call before a thread exits.
+void z_arena_scratch_release(void);
+
+// Adapter so containers taking a z_allocator can live in the arena.
+z_allocator z_arena_allocator(z_arena *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline z_arena z_arena_init(size_t chunk_size, const z_allocator *parent)
+{
+    z_arena a;
+    a.head = NULL;
+    a.spare = NULL;
+    a.last = NULL;
+    a.chunk_size = chunk_size ? chunk_size : ZARENA_DEFAULT_CHUNK;
+    a.parent = parent;
+    return a;
+}
+
+// `align` must be a power of two.
+static inline void *z_arena_alloc_aligned(z_arena *a, size_t align, size_t size)
+{
+    z_arena_chunk *c = a->head;
+    if (Z_LIKELY(NULL != c))
+    {
+        uintptr_t p = ((uintptr_t)c->top + (align - 1)) & ~(uintptr_t)(align - 1);
+        if (Z_LIKELY(p <= (uintptr_t)c->end && size <= (uintptr_t)c->end - p))
+        {
+            c->top = (char *)p + size;
+            a->last = (char *)p;
+            return (void *)p;
+        }
+    }
+    return z_arena_alloc_slow_(a, align, size);
+}
+
+static inline void *z_arena_alloc(z_arena *a, size_t size)
+{
+    return z_arena_alloc_aligned(a, Z_MAX_ALIGN, size);
+}
+
+static inline void *z_arena_calloc(z_arena *a, size_t n, size_t size)
+{
+    if (n && size > (size_t)-1 / n)
+    {
+        return NULL;
+    }
+    void *p = z_arena_alloc(a, n * size);
+    if (p)
+    {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+static inline z_arena_mark z_arena_mark_get(z_arena *a)
+{
+    z_arena_mark m;
+    m.arena = a;
+    m.chunk = a->head;
+    m.top = a->head ? a->head->top : NULL;
+    m.last = a->last;
+    return m;
+}
+
+// Scoped rewind: everything allocated after this line is released at scope exit.
+#if Z_HAS_CLEANUP
+static inline void z_arena_scope_end_(z_arena_mark *m)
+{
+    z_arena_rewind(*m);
+}
+#   define Z_ARENA_SCOPE(arena) \
+        z_arena_mark Z_UNIQUE(z_arena_scope_) Z_CLEANUP(z_arena_scope_end_) = z_arena_mark_get(arena)
+#   define Z_SCRATCH_SCOPE() Z_ARENA_SCOPE(z_arena_scratch())
+#endif
+
+#endif // ZARENA_H
+
+#ifdef ZARENA_IMPLEMENTATION
+#ifndef ZARENA_IMPLEMENTATION_DONE
+#define ZARENA_IMPLEMENTATION_DONE
+
+static z_arena_chunk *z_arena_chunk_new_(z_arena *a, size_t bytes)
+{
+    size_t total = sizeof(z_arena_chunk) + bytes;
+    z_arena_chunk *c = (z_arena_chunk *)(a->parent ? z_alloc(a->parent, total)
+                                                   : ZARENA_CHUNK_MALLOC(total));
+    if (!c)
+    {
+        return NULL;
+    }
+    c->prev = NULL;
+    c->top = (char *)(c + 1);
+    c->end = c->top + bytes;
+    return c;
+}
+
+static void z_arena_chunk_free_(z_arena *a, z_arena_chunk *c)
+{
+    if (a->parent)
+    {
+        z_free(a->parent, c, (size_t)(c->end - (char *)c));
+    }
+    else
+    {
+        ZARENA_CHUNK_FREE(c);
+    }
+}
+
+// Keeps at most one default-sized chunk around for reuse.
+static void z_arena_chunk_retire_(z_arena *a, z_arena_chunk *c)
+{
+    bool standard = (size_t)(c->end - (char *)(c + 1)) == a->chunk_size;
+    if (standard && !a->spare)
+    {
+        c->prev = NULL;
+        c->top = (char *)(c + 1);
+        a->spare = c;
+    }
+    else
+    {
+        z_arena_chunk_free_(a, c);
+    }
+}
+
+void *z_arena_alloc_slow_(z_arena *a, size_t align, size_t size)
+{
+    Z_TRACE_SCOPE("z_arena_alloc_slow");
+    if (size > (size_t)-1 - align - sizeof(z_arena_chunk))
+    {
+        return NULL;
+    }
+    size_t need = size + align - 1;
+    z_arena_chunk *c = NULL;
+    if (a->spare && need <= a->chunk_size)
+    {
+        c = a->spare;
+        a->spare = NULL;
+    }
+    else
+    {
+        c = z_arena_chunk_new_(a, need > a->chunk_size ? need : a->chunk_size);
+        if (!c)
+        {
+            return NULL;
+        }
+    }
+    c->prev = a->head;
+    a->head = c;
+
+    uintptr_t p = ((uintptr_t)c->top + (align - 1)) & ~(uintptr_t)(align - 1);
+    c->top = (char *)p + size;
+    a->last = (char *)p;
+    return (void *)p;
+}
+
+void *z_arena_realloc(z_arena *a, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+    {
+        return z_arena_alloc(a, new_size);
+    }
+
+    // Most recent allocation: move the bump pointer instead of copying.
+    z_arena_chunk *head = a->head;
+    if ((char *)ptr == a->last && head &&
+        (char *)ptr >= (char *)(head + 1) && (char *)ptr <= head->end &&
+        new_size <= (size_t)(head->end - (char *)ptr))
+    {
+        head->top = (char *)ptr + new_size;
+        return ptr;
+    }
+
+    size_t copy = old_size;
+    if (Z_ARENA_UNKNOWN_SIZE == old_size)
+    {
+        /*
+         * The old block ends at or before its chunk's top, exactly at it only
+         * for the most recent allocation. Any other block may be followed by
+         * its neighbours, so it is never kept in place; the copy reads up to
+         * top and is clamped to the new size.
+         */
+        copy = 0;
+        for (z_arena_chunk *c = head; c; c = c->prev)
+        {
+            if ((char *)ptr >= (char *)(c + 1) && (char *)ptr <= c->top)
+            {
+                copy = (size_t)(c->top - (char *)ptr);
+                break;
+            }
+        }
+        old_size = ((char *)ptr == a->last) ? copy : 0;
+    }
+    if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    void *np = z_arena_alloc(a, new_size);
+    if (np)
+    {
+        memcpy(np, ptr, copy < new_size ? copy : new_size);
+    }
+    return np;
+}
+
+void z_arena_rewind(z_arena_mark m)
+{
+    z_arena *a = m.arena;
+    while (a->head && a->head != m.chunk)
+    {
+        z_arena_chunk *c = a->head;
+        a->head = c->prev;
+        z_arena_chunk_retire_(a, c);
+    }
+    if (a->head)
+    {
+        a->head->top = m.top;
+    }
+    a->last = m.last;
+}
+
+void z_arena_reset(z_arena *a)
+{
+    z_arena_mark empty = { a, NULL, NULL, NULL };
+    z_arena_rewind(empty);
+}
+
+void z_arena_free(z_arena *a)
+{
+    z_arena_reset(a);
+    if (a->spare)
+    {
+        z_arena_chunk_free_(a, a->spare);
+        a->spare = NULL;
+    }
+}
+
+static Z_THREAD_LOCAL z_arena z_arena_scratch_;
+static Z_THREAD_LOCAL bool z_arena_scratch_ready_ = false;
+
+z_arena *z_arena_scratch(void)
+{
+    if (Z_UNLIKELY(!z_arena_scratch_ready_))
+    {
+        z_arena_scratch_ = z_arena_init(0, NULL);
+        z_arena_scratch_ready_ = true;
+    }
+    return &z_arena_scratch_;
+}
+
+void z_arena_scratch_release(void)
+{
+    if (z_arena_scratch_ready_)
+    {
+        z_arena_free(&z_arena_scratch_);
+    }
+}
+
+void *z_scratch_malloc(size_t size)
+{
+    return z_arena_alloc(z_arena_scratch(), size);
+}
+
+void *z_scratch_calloc(size_t n, size_t size)
+{
+    return z_arena_calloc(z_arena_scratch(), n, size);
+}
+
+void *z_scratch_realloc(void *ptr, size_t size)
+{
+    return z_arena_realloc(z_arena_scratch(), ptr, Z_ARENA_UNKNOWN_SIZE, size);
+}
+
+static void *z_arena_cb_alloc_(void *ctx, size_t size)
+{
+    return z_arena_alloc((z_arena *)ctx, size);
+}
+
+static void *z_arena_cb_realloc_(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    return z_arena_realloc((z_arena *)ctx, ptr, old_size, new_size);
+}
+
+static void z_arena_cb_free_(void *ctx, void *ptr)
+{
+    (void)ctx; (void)ptr;
+}
+
+// Freeing the most recent block gives its bytes back.
+static void z_arena_cb_sized_free_(void *ctx, void *ptr, size_t size)
+{
+    z_arena *a = (z_arena *)ctx;
+    if ((char *)ptr == a->last && a->head && (char *)ptr + size == a->head->top)
+    {
+        a->head->top = (char *)ptr;
+        a->last = NULL;
+    }
+}
+
+static void *z_arena_cb_aligned_alloc_(void *ctx, size_t align, size_t size)
+{
+    return z_arena_alloc_aligned((z_arena *)ctx, align, size);
+}
+
+z_allocator z_arena_allocator(z_arena *a)
+{
+    z_allocator al = {
+        a,
+        z_arena_cb_alloc_,
+        z_arena_cb_realloc_,
+        z_arena_cb_free_,
+        z_arena_cb_sized_free_,
+        z_arena_cb_aligned_alloc_
+    };
+    return al;
+}
+
+#endif // ZARENA_IMPLEMENTATION_DONE
+#endif // ZARENA_IMPLEMENTATION
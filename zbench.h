@@ -0,0 +1,245 @@
+/*
+ * zbench.h — Micro-benchmark harness for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * A benchmark is a function running its body `iters` times:
+ *
+ *   static void bench_push(void *ctx, uint64_t iters)
+ *   {
+ *       for (uint64_t i = 0; i < iters; i++) { ... Z_BENCH_KEEP(x); }
+ *   }
+ *
+ *   z_bench_result r = z_bench_run("push", bench_push, NULL, NULL);
+ *   z_bench_print(stdout, &r);
+ *
+ * z_bench_run warms up, calibrates the iteration count so each sample lasts
+ * at least `min_sample_ns`, then reports min/median/p99/mean per iteration
+ * plus cycles (TSC / virtual counter where available) and throughput.
+ *
+ * Define ZBENCH_IMPLEMENTATION in exactly one translation unit before
+ * including this header.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZBENCH_H
+#define ZBENCH_H
+
+#include "zcommon.h"
+#include <stdio.h>
+
+// Optimisation barriers: keep a value alive / force pending stores to memory.
+#if defined(__GNUC__) || defined(__clang__)
+#   define Z_BENCH_KEEP(x)   __asm__ __volatile__("" : : "r,m"(x) : "memory")
+#   define Z_BENCH_CLOBBER() __asm__ __volatile__("" : : : "memory")
+#else
+#   define Z_BENCH_KEEP(x)   z_bench_keep_((const volatile void *)&(x))
+#   define Z_BENCH_CLOBBER() z_bench_keep_(NULL)
+#endif
+
+typedef void (*z_bench_fn)(void *ctx, uint64_t iters);
+
+typedef struct z_bench_config {
+    uint64_t warmup_ns;        // Time spent running before measuring.
+    uint64_t min_sample_ns;    // Each sample is scaled up to at least this long.
+    size_t samples;            // Number of timed samples (at most Z_BENCH_MAX_SAMPLES).
+    uint64_t bytes_per_iter;   // If non-zero, throughput is reported.
+} z_bench_config;
+
+#define Z_BENCH_MAX_SAMPLES 1000
+
+#define Z_BENCH_DEFAULTS { 50000000ull, 2000000ull, 51, 0 }
+
+typedef struct z_bench_result {
+    const char *name;
+    uint64_t iters_per_sample;
+    size_t samples;
+    double min_ns;             // All timings are per iteration.
+    double median_ns;
+    double p99_ns;
+    double mean_ns;
+    double cycles;             // Median cycles per iteration (0 if no counter).
+    double mb_per_s;           // From the median (0 without bytes_per_iter).
+} z_bench_result;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void z_bench_keep_(const volatile void *p);
+
+// Monotonic nanoseconds.
+uint64_t z_bench_now_ns(void);
+
+// Raw cycle counter, or 0 where none is available.
+uint64_t z_bench_cycles(void);
+
+// `cfg` may be NULL for Z_BENCH_DEFAULTS.
+z_bench_result z_bench_run(const char *name, z_bench_fn fn, void *ctx, const z_bench_config *cfg);
+
+void z_bench_print_header(FILE *f);
+void z_bench_print(FILE *f, const z_bench_result *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZBENCH_H
+
+#ifdef ZBENCH_IMPLEMENTATION
+#ifndef ZBENCH_IMPLEMENTATION_DONE
+#define ZBENCH_IMPLEMENTATION_DONE
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#endif
+
+static const volatile void *volatile zbench_sink_;
+
+void z_bench_keep_(const volatile void *p)
+{
+    zbench_sink_ = p;
+}
+
+uint64_t z_bench_now_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (0 == freq.QuadPart)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)((double)clock() * (1e9 / CLOCKS_PER_SEC));
+#endif
+}
+
+uint64_t z_bench_cycles(void)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return 0;
+#endif
+}
+
+static int zbench_cmp_double_(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+z_bench_result z_bench_run(const char *name, z_bench_fn fn, void *ctx, const z_bench_config *cfg)
+{
+    static const z_bench_config defaults = Z_BENCH_DEFAULTS;
+    if (!cfg)
+    {
+        cfg = &defaults;
+    }
+    size_t samples = cfg->samples ? cfg->samples : 1;
+    if (samples > Z_BENCH_MAX_SAMPLES)
+    {
+        samples = Z_BENCH_MAX_SAMPLES;
+    }
+
+    // Warm up and calibrate: double the batch until it is long enough.
+    uint64_t iters = 1;
+    uint64_t warm_start = z_bench_now_ns();
+    for (;;)
+    {
+        uint64_t t0 = z_bench_now_ns();
+        fn(ctx, iters);
+        uint64_t dt = z_bench_now_ns() - t0;
+        bool calibrated = dt >= cfg->min_sample_ns;
+        bool warm = z_bench_now_ns() - warm_start >= cfg->warmup_ns;
+        if (calibrated && warm)
+        {
+            break;
+        }
+        if (!calibrated && iters < ((uint64_t)1 << 40))
+        {
+            iters *= 2;
+        }
+    }
+
+    double ns[Z_BENCH_MAX_SAMPLES];
+    double cyc[Z_BENCH_MAX_SAMPLES];
+    double sum = 0.0;
+    for (size_t s = 0; s < samples; s++)
+    {
+        uint64_t c0 = z_bench_cycles();
+        uint64_t t0 = z_bench_now_ns();
+        fn(ctx, iters);
+        uint64_t t1 = z_bench_now_ns();
+        uint64_t c1 = z_bench_cycles();
+        ns[s] = (double)(t1 - t0) / (double)iters;
+        cyc[s] = (double)(c1 - c0) / (double)iters;
+        sum += ns[s];
+    }
+    qsort(ns, samples, sizeof(double), zbench_cmp_double_);
+    qsort(cyc, samples, sizeof(double), zbench_cmp_double_);
+
+    z_bench_result r;
+    r.name = name;
+    r.iters_per_sample = iters;
+    r.samples = samples;
+    r.min_ns = ns[0];
+    r.median_ns = ns[samples / 2];
+    r.p99_ns = ns[(samples * 99) / 100];
+    r.mean_ns = sum / (double)samples;
+    r.cycles = cyc[samples / 2];
+    r.mb_per_s = (cfg->bytes_per_iter && r.median_ns > 0.0)
+               ? (double)cfg->bytes_per_iter / r.median_ns * 1e3
+               : 0.0;
+    return r;
+}
+
+void z_bench_print_header(FILE *f)
+{
+    fprintf(f, "%-40s %12s %12s %12s %10s %10s\n",
+            "benchmark", "median ns", "p99 ns", "min ns", "cycles", "MB/s");
+}
+
+void z_bench_print(FILE *f, const z_bench_result *r)
+{
+    fprintf(f, "%-40s %12.2f %12.2f %12.2f %10.1f ", r->name, r->median_ns, r->p99_ns, r->min_ns, r->cycles);
+    if (r->mb_per_s > 0.0)
+    {
+        fprintf(f, "%10.1f\n", r->mb_per_s);
+    }
+    else
+    {
+        fprintf(f, "%10s\n", "-");
+    }
+}
+
+#endif // ZBENCH_IMPLEMENTATION_DONE
+#endif // ZBENCH_IMPLEMENTATION
@@ -7,6 +7,22 @@ COMMON_FILENAME = "zcommon.h"
 
 COMMON_GUARD = "Z_COMMON_BUNDLED"
 
+INCLUDE_PATTERN = re.compile(r'^[ \t]*#[ \t]*include[ \t]*"([^"]+)".*$', re.MULTILINE)
+
+# Dead-code elimination helpers.
+IDENT_PATTERN = re.compile(r"\b[A-Za-z_]\w*\b")
+COMMENT_OR_STRING = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\\n])*"|\'(?:\\.|[^\'\\\n])*\'', re.DOTALL)
+INLINE_PATTERN = re.compile(r"^static[ \t]+inline\b", re.MULTILINE)
+MACRO_PATTERN = re.compile(r"^[ \t]*#[ \t]*define[ \t]+(\w+)(?:\\\n|[^\n])*", re.MULTILINE)
+TYPEDEF_PATTERN = re.compile(r"\btypedef\b[^;]*?\b(\w+)\s*(?:\[[^\]]*\]\s*)?;")
+STRUCT_PATTERN = re.compile(r"\b(?:struct|union|enum)\s+(\w+)")
+FUNCTION_PATTERN = re.compile(r"^[A-Za-z_][\w \t\*]*?\b(\w+)\s*\([^;{)]*\)\s*[;{]", re.MULTILINE)
+
+# Split mode.
+NOT_FUNCTION_START = re.compile(r"(typedef|struct|union|enum|extern|return)\b")
+IF_DIRECTIVE = re.compile(r"#\s*(if|ifdef|ifndef)\b")
+ENDIF_DIRECTIVE = re.compile(r"#\s*endif\b")
+
 def get_file_content(filepath):
     if not os.path.exists(filepath):
         print(f"Error: File not found: {filepath}")
@@ -14,19 +30,428 @@ def get_file_content(filepath):
     with open(filepath, 'r', encoding='utf-8') as f:
         return f.read()
 
-def strip_local_include(content, header_name):
+def strip_local_include(content, header_name, note=None):
     """
     Removes lines like #include "zcommon.h" from the source.
     It matches quotes specifically, leaving <stdlib.h> alone.
     """
+    if note is None:
+        note = "is included inline in this same file"
     pattern = re.compile(fr'^\s*#include\s*"{re.escape(header_name)}".*$', re.MULTILINE)
-    return pattern.sub(f'// [Bundled] "{header_name}" is included inline in this same file', content)
+    return pattern.sub(f'// [Bundled] "{header_name}" {note}', content)
+
+def strip_comments(code):
+    # Drops comments and literals so they do not count as references.
+    return COMMENT_OR_STRING.sub(" ", code)
+
+def resolve_include(name, including_dir, include_dirs):
+    for base in [including_dir] + list(include_dirs):
+        candidate = os.path.normpath(os.path.join(base, name))
+        if os.path.isfile(candidate):
+            return candidate
+    return None
+
+def resolve_libraries(sources, include_dirs=()):
+    """
+    Follows local #include "..." lines from `sources` and returns
+    (ordered_paths, contents, deps): every library reached, each placed after
+    the libraries it includes. zcommon.h is left out; it is bundled once up
+    front. Includes that cannot be found are left in place.
+    """
+    contents = {}
+    deps = {}
+    pending = [os.path.normpath(s) for s in sources]
+    while pending:
+        path = pending.pop(0)
+        if path in contents:
+            continue
+        contents[path] = get_file_content(path)
+        deps[path] = []
+        for name in INCLUDE_PATTERN.findall(contents[path]):
+            if os.path.basename(name) == COMMON_FILENAME:
+                continue
+            found = resolve_include(name, os.path.dirname(path), include_dirs)
+            if found is None:
+                print(f"  Note: {os.path.basename(path)} includes \"{name}\", not found; left as is.")
+                continue
+            if found not in deps[path]:
+                deps[path].append(found)
+                pending.append(found)
+
+    # Depth-first post-order keeps the input order wherever the graph allows.
+    order = []
+    state = {}
+    def visit(path, stack):
+        if state.get(path) == "done":
+            return
+        if state.get(path) == "active":
+            cycle = " -> ".join(os.path.basename(p) for p in stack + [path])
+            print(f"  Warning: include cycle {cycle}; keeping input order.")
+            return
+        state[path] = "active"
+        for dep in deps[path]:
+            visit(dep, stack + [path])
+        state[path] = "done"
+        order.append(path)
+    for path in contents:
+        visit(path, [])
+    return order, contents, deps
+
+def defined_names(code):
+    """
+    Functions, macros, typedefs and tags a library defines or declares.
+    """
+    code = strip_comments(code)
+    names = set(MACRO_PATTERN.findall(code))
+    names.update(TYPEDEF_PATTERN.findall(code))
+    names.update(STRUCT_PATTERN.findall(code))
+    names.update(FUNCTION_PATTERN.findall(code))
+    return names
+
+def skip_balanced(code, pos, open_ch, close_ch):
+    """
+    `pos` is at `open_ch`; returns the index just past its match, skipping
+    comments and literals. Returns -1 if unbalanced.
+    """
+    depth = 0
+    i = pos
+    n = len(code)
+    while i < n:
+        c = code[i]
+        if c == '/' and code.startswith("//", i):
+            i = code.find("\n", i)
+            if i < 0:
+                return -1
+        elif c == '/' and code.startswith("/*", i):
+            i = code.find("*/", i + 2)
+            if i < 0:
+                return -1
+            i += 1
+        elif c in "\"'":
+            i += 1
+            while i < n and code[i] != c:
+                i += 2 if code[i] == '\\' else 1
+        elif c == open_ch:
+            depth += 1
+        elif c == close_ch:
+            depth -= 1
+            if depth == 0:
+                return i + 1
+        i += 1
+    return -1
+
+def blank_comments(code):
+    # Same length and line breaks as `code`, with comments and literals blanked.
+    return COMMENT_OR_STRING.sub(lambda m: re.sub(r"[^\n]", " ", m.group(0)), code)
+
+def implementation_macro(path):
+    # src/zvec.c -> ZVEC_IMPLEMENTATION
+    stem = os.path.splitext(os.path.basename(path))[0]
+    return re.sub(r"\W", "_", stem).upper() + "_IMPLEMENTATION"
+
+def top_level_functions(code):
+    """
+    Yields (name, start, body_start, end) for function definitions at file
+    scope: outside any #if block other than the include guard, and outside
+    braces other than `extern "C" {`. Definitions already under a
+    conditional are left to the library.
+    """
+    blank = blank_comments(code)
+    stack = []          # "guard" for the include guard, "if" for the rest
+    seen_guard = False
+    braces = 0
+    extern_c = 0
+    pos = 0
+    n = len(code)
+    while pos < n:
+        eol = code.find("\n", pos)
+        eol = n if eol < 0 else eol + 1
+        line = blank[pos:eol]
+        text = line.strip()
+
+        if text.startswith("#"):
+            m = IF_DIRECTIVE.match(text)
+            if m:
+                # The first top-level #ifndef is taken as the include guard.
+                is_guard = not stack and not seen_guard and m.group(1) == "ifndef"
+                stack.append("guard" if is_guard else "if")
+                seen_guard = seen_guard or is_guard
+            elif ENDIF_DIRECTIVE.match(text) and stack:
+                stack.pop()
+            pos = eol
+            continue
+
+        top = stack in ([], ["guard"]) and braces == 0
+        if code.startswith('extern "C"', pos) and text.endswith("{"):
+            extern_c += 1
+            pos = eol
+            continue
+        if text == "}" and braces == 0 and extern_c:
+            extern_c -= 1
+            pos = eol
+            continue
+
+        if top and (line[:1].isalpha() or line[:1] == "_"):
+            brace = blank.find("{", pos)
+            semi = blank.find(";", pos)
+            header = blank[pos:brace] if brace >= 0 else ""
+            if (brace >= 0 and (semi < 0 or brace < semi) and "(" in header and "=" not in header
+                    and not NOT_FUNCTION_START.match(text)):
+                end = skip_balanced(blank, brace, "{", "}")
+                if end > 0:
+                    names = IDENT_PATTERN.findall(header[:header.index("(")])
+                    if code.startswith("\n", end):
+                        end += 1
+                    yield names[-1], pos, brace, end
+                    pos = end
+                    continue
+
+        braces += line.count("{") - line.count("}")
+        pos = eol
+
+def split_library(path, code, outline=()):
+    """
+    STB-style split of one library: file-scope function bodies move behind
+    #ifdef <NAME>_IMPLEMENTATION at the end and leave a prototype in their
+    place. `static inline` functions are the library's chosen hot paths and
+    stay in the header unless named in `outline`, which makes them plain
+    extern functions. Internal `_`-suffixed helpers never get external
+    linkage: like other `static` helpers, they move only when the header no
+    longer uses them. Returns (code, stats).
+    """
+    macro = implementation_macro(path)
+    funcs = list(top_level_functions(code))
+    plan = {}
+    for name, start, body, end in funcs:
+        header = code[start:body].rstrip()
+        words = IDENT_PATTERN.findall(header[:header.index("(")])
+        if "static" in words and "inline" in words:
+            if name not in outline:
+                continue
+            if name.endswith("_"):
+                plan[name] = ("static", header)
+                continue
+            header = re.sub(r"\b(static|inline)\s+", "", header, count=2)
+            plan[name] = ("extern", header)
+        elif "static" in words:
+            plan[name] = ("static", header)
+        else:
+            plan[name] = ("extern", header)
+
+    # A static helper the header still calls has to stay with it.
+    while True:
+        parts = []
+        last = 0
+        for name, start, body, end in funcs:
+            if name in plan:
+                parts.append(code[last:start])
+                if plan[name][0] == "extern":
+                    parts.append(plan[name][1] + ";\n")
+                elif code.startswith("\n", end):
+                    end += 1  # Nothing left in its place; drop the blank line too.
+                last = end
+        parts.append(code[last:])
+        used = set(IDENT_PATTERN.findall(strip_comments("".join(parts))))
+        pinned = [n for n, (kind, _) in plan.items() if kind == "static" and n in used]
+        if not pinned:
+            break
+        for name in pinned:
+            del plan[name]
+
+    if not plan:
+        return code, {"macro": macro, "moved": 0, "bytes": 0, "kept": len(funcs)}
 
-def create_bundle(source_path, common_path, output_path):
-    print(f"Bundling:\n  Source: {source_path}\n  Common: {common_path}\n  Output: {output_path}")
+    bodies = []
+    for name, start, body, end in funcs:
+        if name in plan:
+            text = code[start:end]
+            if plan[name][0] == "extern":
+                # Same definition, minus `static inline`.
+                text = plan[name][1] + text[len(code[start:body].rstrip()):]
+            bodies.append(text.rstrip("\n") + "\n")
+
+    done = macro + ("_SPLIT_DONE" if macro + "_DONE" in code else "_DONE")
+    header_part = "".join(parts).rstrip("\n") + "\n"
+    # The implementation unit includes the header twice, so it needs a guard.
+    directives = re.findall(r"^[ \t]*#[ \t]*(\w+)[ \t]*(\w*)", blank_comments(code), re.MULTILINE)
+    if not (len(directives) >= 2 and directives[0][0] == "ifndef" and directives[1] == ("define", directives[0][1])):
+        guard = macro[:-len("IMPLEMENTATION")] + "H"
+        header_part = f"#ifndef {guard}\n#define {guard}\n\n{header_part}\n#endif // {guard}\n"
+    out = [header_part, "\n"]
+    out.append(f"#ifdef {macro}\n#ifndef {done}\n#define {done}\n\n")
+    out.append("\n".join(bodies))
+    out.append(f"\n#endif // {done}\n#endif // {macro}\n")
+    return "".join(out), {
+        "macro": macro,
+        "moved": len(plan),
+        "bytes": len(code) - len(header_part),
+        "kept": len(funcs) - len(plan),
+    }
+
+def find_inline_functions(code):
+    """
+    Yields (name, start, end) for every `static inline` definition, `start`
+    including the comment lines directly above it.
+    """
+    for m in INLINE_PATTERN.finditer(code):
+        paren = code.find("(", m.end())
+        brace_or_semi = min((p for p in (code.find("{", m.end()), code.find(";", m.end())) if p >= 0), default=-1)
+        if paren < 0 or brace_or_semi < paren:
+            continue
+        names = IDENT_PATTERN.findall(code[m.end():paren])
+        if not names:
+            continue
+        close = skip_balanced(code, paren, "(", ")")
+        if close < 0:
+            continue
+        body = close
+        while body < len(code) and code[body].isspace():
+            body += 1
+        if body >= len(code) or code[body] != "{":
+            continue  # Prototype only.
+        end = skip_balanced(code, body, "{", "}")
+        if end < 0:
+            continue
+        if code.startswith("\n", end):
+            end += 1
+
+        start = m.start()
+        while start > 0:
+            prev_start = code.rfind("\n", 0, start - 1) + 1
+            line = code[prev_start:start].strip()
+            if line.startswith("//"):
+                start = prev_start
+            elif line.endswith("*/"):
+                open_at = code.rfind("/*", 0, start)
+                start = code.rfind("\n", 0, open_at) + 1
+            else:
+                break
+        yield names[-1], start, end
+
+def strip_unused(libraries, keep):
+    """
+    Removes `static inline` functions that nothing in `keep` reaches.
+    `libraries` is a list of (path, code); returns the new list and the
+    names removed.
+
+    Anything that is not a static inline function or a macro (extern
+    function bodies, declarations) is always kept and counts as a use.
+    Macros count only when something reachable names them.
+    """
+    inlines = {}
+    macros = {}
+    roots = set(keep)
+    for _, code in libraries:
+        spans = list(find_inline_functions(code))
+        rest = []
+        last = 0
+        for name, start, end in spans:
+            inlines.setdefault(name, []).append(strip_comments(code[start:end]))
+            rest.append(code[last:start])
+            last = end
+        rest.append(code[last:])
+        rest = strip_comments("".join(rest))
+        for m in MACRO_PATTERN.finditer(rest):
+            macros.setdefault(m.group(1), []).append(m.group(0))
+        roots.update(IDENT_PATTERN.findall(MACRO_PATTERN.sub(" ", rest)))
+
+    reachable = set()
+    work = [name for name in roots if name in inlines or name in macros]
+    while work:
+        name = work.pop()
+        if name in reachable:
+            continue
+        reachable.add(name)
+        for text in inlines.get(name, []) + macros.get(name, []):
+            for ref in IDENT_PATTERN.findall(text):
+                if ref not in reachable and (ref in inlines or ref in macros):
+                    work.append(ref)
+
+    removed = set()
+    result = []
+    for path, code in libraries:
+        out = []
+        last = 0
+        for name, start, end in find_inline_functions(code):
+            if name in reachable:
+                continue
+            out.append(code[last:start])
+            last = end
+            removed.add(name)
+        out.append(code[last:])
+        result.append((path, "".join(out)))
+    return result, removed
+
+def create_bundle(source_path, common_path, output_path, keep=None, include_dirs=(), expected=(),
+                  split=False, outline=()):
+    """
+    Bundles one or more z-libs (`source_path` may be a path or a list) and
+    the local headers they include into `output_path`, dependencies first,
+    with zcommon.h once at the top.
+
+    With `keep` (the functions, macros and types the application uses),
+    libraries that define none of them and are not needed by one that does
+    are dropped, and unreachable `static inline` functions are stripped.
+    zcommon.h is never stripped, so stripped bundles still share the
+    Z_COMMON_BUNDLED payload with other z-libs. Names in `expected` that no
+    library defines are reported.
+
+    With `split`, each library's function bodies move behind its
+    <NAME>_IMPLEMENTATION guard (see split_library).
+    """
+    sources = [source_path] if isinstance(source_path, str) else list(source_path)
+    print(f"Bundling:\n  Source: {', '.join(sources)}\n  Common: {common_path}\n  Output: {output_path}")
 
-    source_code = get_file_content(source_path)
     common_code = get_file_content(common_path)
+    order, contents, deps = resolve_libraries(sources, include_dirs)
+
+    if keep is not None:
+        keep = set(keep)
+        used = set()
+        found = set()
+        for path in order:
+            names = defined_names(contents[path]) & keep
+            if names:
+                used.add(path)
+                found |= names
+        for name in sorted(set(expected) - found - set(IDENT_PATTERN.findall(strip_comments(common_code)))):
+            print(f"  Warning: '{name}' is not defined by any bundled library.")
+        # Libraries needed by a used one stay too.
+        stack = list(used)
+        while stack:
+            for dep in deps[stack.pop()]:
+                if dep not in used:
+                    used.add(dep)
+                    stack.append(dep)
+        dropped = [p for p in order if p not in used]
+        if dropped:
+            print(f"  Dropped unused: {', '.join(os.path.basename(p) for p in dropped)}")
+        order = [p for p in order if p in used]
+
+    bundled_names = {os.path.basename(p) for p in order}
+    libraries = []
+    for path in order:
+        code = strip_local_include(contents[path], COMMON_FILENAME)
+        for name in INCLUDE_PATTERN.findall(code):
+            if os.path.basename(name) in bundled_names:
+                code = strip_local_include(code, name, "is included earlier in this same file")
+        libraries.append((path, code))
+
+    if keep is not None:
+        before = sum(len(code) for _, code in libraries)
+        libraries, removed = strip_unused(libraries, keep)
+        after = sum(len(code) for _, code in libraries)
+        print(f"  Stripped {len(removed)} unused static inline functions ({before - after} bytes).")
+
+    if split:
+        result = []
+        for path, code in libraries:
+            new_code, stats = split_library(path, code, outline)
+            share = 100.0 * stats["bytes"] / max(1, len(code))
+            print(f"  {os.path.basename(path)}: moved {stats['moved']} bodies ({stats['bytes']} bytes, "
+                  f"{share:.0f}% of the header) behind {stats['macro']}; {stats['kept']} stay inline.")
+            result.append((path, new_code))
+        libraries = result
 
     common_payload = f"""
 /* ============================================================================
@@ -43,35 +468,74 @@ def create_bundle(source_path, common_path, output_path):
 /* ============================================================================ */
 """
 
-    processed_source = strip_local_include(source_code, COMMON_FILENAME)
-
     output_dir = os.path.dirname(output_path)
     if output_dir:  # Only try to create dirs if there IS a directory path
         os.makedirs(output_dir, exist_ok=True)
-    
+
     with open(output_path, 'w', encoding='utf-8') as f:
         f.write("/*\n")
         f.write(" * GENERATED FILE - DO NOT EDIT DIRECTLY\n")
-        f.write(f" * Source: {os.path.basename(source_path)}\n")
+        f.write(f" * Source: {', '.join(os.path.basename(p) for p, _ in libraries)}\n")
         f.write(" *\n")
         f.write(" * This file is part of the z-libs collection: https://github.com/z-libs\n")
         f.write(" * Licensed under the MIT License.\n")
         f.write(" */\n\n")
-        
+
         f.write(common_payload)
-        f.write("\n")
-        f.write(processed_source)
+        for path, code in libraries:
+            f.write("\n")
+            if len(libraries) > 1:
+                f.write(f"/* ---- {os.path.basename(path)} ---- */\n")
+            f.write(code)
 
     print(f"Success! Created {output_path}")
 
+def read_keep_list(names, files):
+    """
+    Symbols from --keep (comma separated) and --keep-from files. A .txt file
+    lists one name per line; any other file is treated as application
+    source and every identifier in it counts. Returns (keep, expected):
+    `expected` holds the names that were listed explicitly.
+    """
+    expected = set()
+    for entry in names:
+        expected.update(n.strip() for n in entry.split(",") if n.strip())
+    keep = set(expected)
+    for path in files:
+        text = get_file_content(path)
+        if path.endswith(".txt"):
+            listed = {line.strip() for line in text.splitlines()
+                      if line.strip() and not line.lstrip().startswith("#")}
+            expected |= listed
+            keep |= listed
+        else:
+            keep.update(IDENT_PATTERN.findall(strip_comments(text)))
+    return keep, expected
+
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description="Bundle a z-lib header with zcommon.h")
-    parser.add_argument("source", help="Path to the raw library file (e.g., src/zvec_impl.h)")
+    parser = argparse.ArgumentParser(description="Bundle z-lib headers with zcommon.h")
+    parser.add_argument("sources", nargs="+", help="Raw library files (e.g., src/zvec_impl.h); local includes are followed")
     parser.add_argument("output", help="Path to the destination file (e.g., dist/zvec.h)")
-    
+
     default_common = os.path.join(os.path.dirname(os.path.abspath(__file__)), COMMON_FILENAME)
     parser.add_argument("--common", default=default_common, help="Path to zcommon.h")
+    parser.add_argument("-I", dest="include_dirs", action="append", default=[],
+                        help="Extra directory to search for included libraries (repeatable)")
+    parser.add_argument("--keep", action="append", default=[], metavar="NAMES",
+                        help="Comma separated symbols the application uses; enables stripping")
+    parser.add_argument("--keep-from", action="append", default=[], metavar="FILE",
+                        help="Symbol list (.txt) or application source to take used symbols from")
+
+    parser.add_argument("--split", action="store_true",
+                        help="Move function bodies behind <NAME>_IMPLEMENTATION (STB style)")
+    parser.add_argument("--outline", action="append", default=[], metavar="NAMES",
+                        help="With --split, comma separated static inline functions to move out of the header too")
 
     args = parser.parse_args()
-    
-    create_bundle(args.source, args.common, args.output)
+
+    outline = {n.strip() for entry in args.outline for n in entry.split(",") if n.strip()}
+    keep, expected = None, ()
+    if args.keep or args.keep_from:
+        keep, expected = read_keep_list(args.keep, args.keep_from)
+    create_bundle(args.sources, args.common, args.output, keep, args.include_dirs, expected,
+                  args.split, outline)
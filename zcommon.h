@@ -31,9 +31,35 @@
 #define Z_ENOTFOUND  -5   // Element not found.
 #define Z_EINVAL     -6   // Invalid argument / parameter.
 #define Z_EEXIST     -7   // Element already exists.
+#define Z_EFULL      -8   // Bounded container is full.
 
 // Memory management.
 
+/* * Allocation tracking (see ztrack.h). Compile with -DZ_TRACK_ALLOC to route
+ * the Z_MALLOC family through counters that record the call site.
+ * The tracked backend is chosen with Z_TRACK_BASE_MALLOC & co. in the unit
+ * that defines ZTRACK_IMPLEMENTATION. Without Z_TRACK_ALLOC nothing changes.
+ */
+#ifdef Z_TRACK_ALLOC
+#   ifdef Z_MALLOC
+#       error "Z_TRACK_ALLOC replaces Z_MALLOC; set Z_TRACK_BASE_MALLOC/REALLOC/FREE instead."
+#   endif
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+void *z_track_malloc(size_t size, const char *file, int line);
+void *z_track_calloc(size_t n, size_t size, const char *file, int line);
+void *z_track_realloc(void *ptr, size_t size, const char *file, int line);
+void  z_track_free(void *ptr, const char *file, int line);
+#   ifdef __cplusplus
+}
+#   endif
+#   define Z_MALLOC(sz)       z_track_malloc(sz, __FILE__, __LINE__)
+#   define Z_CALLOC(n, sz)    z_track_calloc(n, sz, __FILE__, __LINE__)
+#   define Z_REALLOC(p, sz)   z_track_realloc(p, sz, __FILE__, __LINE__)
+#   define Z_FREE(p)          z_track_free(p, __FILE__, __LINE__)
+#endif
+
 /* * If the user hasn't defined their own allocator, use the standard C library.
  * To override globally, define these macros before including any ZDK header.
  */
@@ -43,8 +69,162 @@
 #   define Z_CALLOC(n, sz)    calloc(n, sz)
 #   define Z_REALLOC(p, sz)   realloc(p, sz)
 #   define Z_FREE(p)          free(p)
+#   define Z_MALLOC_IS_STDLIB 1
 #endif
 
+/* * Strictest alignment the Z_MALLOC family guarantees. Matches what common
+ * malloc implementations return; override if your allocator differs.
+ */
+#ifndef Z_MAX_ALIGN
+#   define Z_MAX_ALIGN (2 * sizeof(void *))
+#endif
+
+// Allocator interface.
+
+/* * Context-carrying allocator for per-instance memory control.
+ * Containers that take a `const z_allocator *` route all storage through it,
+ * so one container can live in a request arena while another uses the heap.
+ * Passing NULL anywhere an allocator is expected selects the default, which
+ * forwards to the Z_MALLOC family above.
+ *
+ * Only `alloc` and `free` are required. `realloc`, `sized_free` and
+ * `aligned_alloc` may be NULL; the z_* helpers below fall back accordingly.
+ * Old sizes are always passed so arenas can grow or drop blocks in place.
+ */
+typedef struct z_allocator {
+    void *ctx;
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void  (*free)(void *ctx, void *ptr);
+    void  (*sized_free)(void *ctx, void *ptr, size_t size);
+    void *(*aligned_alloc)(void *ctx, size_t align, size_t size);
+} z_allocator;
+
+static inline void *z_default_alloc_(void *ctx, size_t size)
+{
+    (void)ctx;
+    return Z_MALLOC(size);
+}
+
+static inline void *z_default_realloc_(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    (void)ctx; (void)old_size;
+    return Z_REALLOC(ptr, new_size);
+}
+
+static inline void z_default_free_(void *ctx, void *ptr)
+{
+    (void)ctx;
+    Z_FREE(ptr);
+}
+
+// Over-aligned blocks are only safe to release with Z_FREE if it is free().
+#if defined(Z_MALLOC_IS_STDLIB) && !defined(_MSC_VER) && \
+    (defined(__cplusplus) ? __cplusplus >= 201703L : (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L))
+static inline void *z_default_aligned_alloc_(void *ctx, size_t align, size_t size)
+{
+    (void)ctx;
+    // aligned_alloc() requires size to be a multiple of align.
+    return aligned_alloc(align, (size + align - 1) & ~(align - 1));
+}
+#   define Z_DEFAULT_ALIGNED_ALLOC_ z_default_aligned_alloc_
+#else
+#   define Z_DEFAULT_ALIGNED_ALLOC_ NULL
+#endif
+
+static inline const z_allocator *z_default_allocator(void)
+{
+    static const z_allocator def = {
+        NULL,
+        z_default_alloc_,
+        z_default_realloc_,
+        z_default_free_,
+        NULL,
+        Z_DEFAULT_ALIGNED_ALLOC_
+    };
+    return &def;
+}
+
+#define Z_DEFAULT_ALLOCATOR (z_default_allocator())
+
+// Resolves NULL to the default instance.
+#define Z_ALLOCATOR_OR_DEFAULT(a) ((a) ? (a) : z_default_allocator())
+
+static inline void *z_alloc(const z_allocator *a, size_t size)
+{
+    a = Z_ALLOCATOR_OR_DEFAULT(a);
+    return (a->alloc)(a->ctx, size);
+}
+
+static inline void *z_calloc(const z_allocator *a, size_t n, size_t size)
+{
+    if (n && size > (size_t)-1 / n)
+    {
+        return NULL;
+    }
+    if (!a)
+    {
+        return Z_CALLOC(n, size);
+    }
+    void *p = (a->alloc)(a->ctx, n * size);
+    if (p)
+    {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+static inline void z_free(const z_allocator *a, void *ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    a = Z_ALLOCATOR_OR_DEFAULT(a);
+    if (a->sized_free)
+    {
+        (a->sized_free)(a->ctx, ptr, size);
+    }
+    else
+    {
+        (a->free)(a->ctx, ptr);
+    }
+}
+
+static inline void *z_realloc(const z_allocator *a, void *ptr, size_t old_size, size_t new_size)
+{
+    a = Z_ALLOCATOR_OR_DEFAULT(a);
+    if (a->realloc)
+    {
+        return (a->realloc)(a->ctx, ptr, old_size, new_size);
+    }
+    // Emulate with alloc + copy + free.
+    void *np = (a->alloc)(a->ctx, new_size);
+    if (np && ptr)
+    {
+        memcpy(np, ptr, old_size < new_size ? old_size : new_size);
+        z_free(a, ptr, old_size);
+    }
+    return np;
+}
+
+/* * Returns NULL when the allocator cannot honour `align`.
+ * Requests at or below Z_MAX_ALIGN are served by plain `alloc`.
+ */
+static inline void *z_aligned_alloc(const z_allocator *a, size_t align, size_t size)
+{
+    a = Z_ALLOCATOR_OR_DEFAULT(a);
+    if (align <= Z_MAX_ALIGN)
+    {
+        return (a->alloc)(a->ctx, size);
+    }
+    if (0 != (align & (align - 1)) || !a->aligned_alloc)
+    {
+        return NULL;
+    }
+    return (a->aligned_alloc)(a->ctx, align, size);
+}
+
 
 // Compiler extensions and optimization.
 
@@ -89,6 +269,150 @@
 
 #endif
 
+// Thread-local storage.
+#if defined(__TINYC__)
+    // TCC has no TLS support; storage degrades to a plain global.
+#   define Z_THREAD_LOCAL
+#   define Z_HAS_THREAD_LOCAL 0
+#elif defined(__cplusplus) && __cplusplus >= 201103L
+#   define Z_THREAD_LOCAL thread_local
+#   define Z_HAS_THREAD_LOCAL 1
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 202311L
+#   define Z_THREAD_LOCAL thread_local
+#   define Z_HAS_THREAD_LOCAL 1
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#   define Z_THREAD_LOCAL _Thread_local
+#   define Z_HAS_THREAD_LOCAL 1
+#elif defined(__GNUC__) || defined(__clang__)
+#   define Z_THREAD_LOCAL __thread
+#   define Z_HAS_THREAD_LOCAL 1
+#elif defined(_MSC_VER)
+#   define Z_THREAD_LOCAL __declspec(thread)
+#   define Z_HAS_THREAD_LOCAL 1
+#else
+#   define Z_THREAD_LOCAL
+#   define Z_HAS_THREAD_LOCAL 0
+#endif
+
+// Atomics.
+
+/* * Declare shared fields as Z_ATOMIC(T) and access them only through the
+ * Z_ATOMIC_* macros, with Z_MO_* orders. Backed by std::atomic in C++,
+ * <stdatomic.h> in C11 and the __atomic builtins in older GNU C modes.
+ * Elsewhere Z_HAS_ATOMICS is 0 and the macros are plain accesses, which is
+ * only correct for single-threaded programs (Z_ATOMIC_EXCHANGE is then
+ * missing; Z_ATOMIC_CAS works everywhere).
+ */
+#if defined(__cplusplus)
+#   include <atomic>
+#   define Z_ATOMIC(T)                      std::atomic<T>
+#   define Z_MO_RELAXED                     std::memory_order_relaxed
+#   define Z_MO_ACQUIRE                     std::memory_order_acquire
+#   define Z_MO_RELEASE                     std::memory_order_release
+#   define Z_MO_ACQ_REL                     std::memory_order_acq_rel
+#   define Z_MO_SEQ_CST                     std::memory_order_seq_cst
+#   define Z_ATOMIC_LOAD(p, mo)             ((p)->load(mo))
+#   define Z_ATOMIC_STORE(p, v, mo)         ((p)->store((v), (mo)))
+#   define Z_ATOMIC_EXCHANGE(p, v, mo)      ((p)->exchange((v), (mo)))
+#   define Z_ATOMIC_FETCH_ADD(p, v, mo)     ((p)->fetch_add((v), (mo)))
+#   define Z_ATOMIC_FETCH_SUB(p, v, mo)     ((p)->fetch_sub((v), (mo)))
+#   define Z_ATOMIC_CAS(p, exp, des, s, f)  ((p)->compare_exchange_strong(*(exp), (des), (s), (f)))
+#   define Z_ATOMIC_CAS_WEAK(p, exp, des, s, f) ((p)->compare_exchange_weak(*(exp), (des), (s), (f)))
+#   define Z_ATOMIC_FENCE(mo)               std::atomic_thread_fence(mo)
+#   define Z_HAS_ATOMICS 1
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#   include <stdatomic.h>
+#   define Z_ATOMIC(T)                      _Atomic(T)
+#   define Z_MO_RELAXED                     memory_order_relaxed
+#   define Z_MO_ACQUIRE                     memory_order_acquire
+#   define Z_MO_RELEASE                     memory_order_release
+#   define Z_MO_ACQ_REL                     memory_order_acq_rel
+#   define Z_MO_SEQ_CST                     memory_order_seq_cst
+#   define Z_ATOMIC_LOAD(p, mo)             atomic_load_explicit((p), (mo))
+#   define Z_ATOMIC_STORE(p, v, mo)         atomic_store_explicit((p), (v), (mo))
+#   define Z_ATOMIC_EXCHANGE(p, v, mo)      atomic_exchange_explicit((p), (v), (mo))
+#   define Z_ATOMIC_FETCH_ADD(p, v, mo)     atomic_fetch_add_explicit((p), (v), (mo))
+#   define Z_ATOMIC_FETCH_SUB(p, v, mo)     atomic_fetch_sub_explicit((p), (v), (mo))
+#   define Z_ATOMIC_CAS(p, exp, des, s, f)  atomic_compare_exchange_strong_explicit((p), (exp), (des), (s), (f))
+#   define Z_ATOMIC_CAS_WEAK(p, exp, des, s, f) atomic_compare_exchange_weak_explicit((p), (exp), (des), (s), (f))
+#   define Z_ATOMIC_FENCE(mo)               atomic_thread_fence(mo)
+#   define Z_HAS_ATOMICS 1
+#elif defined(__GNUC__) || defined(__clang__)
+#   define Z_ATOMIC(T)                      T
+#   define Z_MO_RELAXED                     __ATOMIC_RELAXED
+#   define Z_MO_ACQUIRE                     __ATOMIC_ACQUIRE
+#   define Z_MO_RELEASE                     __ATOMIC_RELEASE
+#   define Z_MO_ACQ_REL                     __ATOMIC_ACQ_REL
+#   define Z_MO_SEQ_CST                     __ATOMIC_SEQ_CST
+#   define Z_ATOMIC_LOAD(p, mo)             __atomic_load_n((p), (mo))
+#   define Z_ATOMIC_STORE(p, v, mo)         __atomic_store_n((p), (v), (mo))
+#   define Z_ATOMIC_EXCHANGE(p, v, mo)      __atomic_exchange_n((p), (v), (mo))
+#   define Z_ATOMIC_FETCH_ADD(p, v, mo)     __atomic_fetch_add((p), (v), (mo))
+#   define Z_ATOMIC_FETCH_SUB(p, v, mo)     __atomic_fetch_sub((p), (v), (mo))
+#   define Z_ATOMIC_CAS(p, exp, des, s, f)  __atomic_compare_exchange_n((p), (exp), (des), false, (s), (f))
+#   define Z_ATOMIC_CAS_WEAK(p, exp, des, s, f) __atomic_compare_exchange_n((p), (exp), (des), true, (s), (f))
+#   define Z_ATOMIC_FENCE(mo)               __atomic_thread_fence(mo)
+#   define Z_HAS_ATOMICS 1
+#else
+#   define Z_ATOMIC(T)                      T
+#   define Z_MO_RELAXED                     0
+#   define Z_MO_ACQUIRE                     0
+#   define Z_MO_RELEASE                     0
+#   define Z_MO_ACQ_REL                     0
+#   define Z_MO_SEQ_CST                     0
+#   define Z_ATOMIC_LOAD(p, mo)             (*(p))
+#   define Z_ATOMIC_STORE(p, v, mo)         ((void)(*(p) = (v)))
+#   define Z_ATOMIC_FETCH_ADD(p, v, mo)     ((*(p) += (v)) - (v))
+#   define Z_ATOMIC_FETCH_SUB(p, v, mo)     ((*(p) -= (v)) + (v))
+#   define Z_ATOMIC_CAS(p, exp, des, s, f)  \
+        (*(p) == *(exp) ? (*(p) = (des), true) : (*(exp) = *(p), false))
+#   define Z_ATOMIC_CAS_WEAK(p, exp, des, s, f) Z_ATOMIC_CAS(p, exp, des, s, f)
+#   define Z_ATOMIC_FENCE(mo)               ((void)0)
+#   define Z_HAS_ATOMICS 0
+#endif
+
+/* * Cache-line size used to keep independently written fields apart.
+ * Z_CACHE_ALIGNED aligns a declaration to a line (honoured for static and
+ * stack objects); Z_CACHE_PAD(bytes_used) adds a struct member that pushes
+ * the next field onto a new line even for heap objects.
+ */
+#ifndef Z_CACHE_LINE
+#   if (defined(__APPLE__) && defined(__aarch64__)) || defined(__powerpc64__)
+#       define Z_CACHE_LINE 128
+#   else
+#       define Z_CACHE_LINE 64
+#   endif
+#endif
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#   define Z_CACHE_ALIGNED alignas(Z_CACHE_LINE)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#   define Z_CACHE_ALIGNED _Alignas(Z_CACHE_LINE)
+#elif defined(__GNUC__) || defined(__clang__) || defined(__TINYC__)
+#   define Z_CACHE_ALIGNED __attribute__((aligned(Z_CACHE_LINE)))
+#elif defined(_MSC_VER)
+#   define Z_CACHE_ALIGNED __declspec(align(Z_CACHE_LINE))
+#else
+#   define Z_CACHE_ALIGNED
+#endif
+
+#define Z_CACHE_PAD(used) char Z_CONCAT(z_pad_, __LINE__)[Z_CACHE_LINE - ((used) % Z_CACHE_LINE)]
+
+// Busy-wait hint for spin loops (PAUSE / YIELD).
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   define Z_CPU_RELAX() __builtin_ia32_pause()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+#   define Z_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#   define Z_CPU_RELAX() _mm_pause()
+#elif defined(_MSC_VER) && (defined(_M_ARM64) || defined(_M_ARM))
+#   include <intrin.h>
+#   define Z_CPU_RELAX() __yield()
+#else
+#   define Z_CPU_RELAX() ((void)0)
+#endif
+
 
 // Metaprogramming and internal utils.
 
@@ -96,6 +420,7 @@
  * For the C compiler, they are no-ops (they compile to nothing).
  */
 #define DEFINE_VEC_TYPE(T, Name)
+#define DEFINE_SMALL_VEC_TYPE(T, N, Name)
 #define DEFINE_LIST_TYPE(T, Name)
 #define DEFINE_MAP_TYPE(Key, Val, Name)
 #define DEFINE_STABLE_MAP_TYPE(Key, Val, Name)
@@ -106,6 +431,44 @@
 #define Z_CONCAT(a, b) Z_CONCAT_(a, b)
 #define Z_UNIQUE(prefix) Z_CONCAT(prefix, __LINE__)
 
+/* * Scoped tracing (see ztrace.h). Compile with -DZ_TRACE and
+ * Z_TRACE_SCOPE("name") records the time spent until the end of the
+ * enclosing block into a per-thread ring, exported as Chrome trace JSON.
+ * `name` must outlive the trace (string literals are ideal).
+ * Without Z_TRACE, or without cleanup support in C, it compiles to nothing.
+ */
+typedef struct z_trace_span_ {
+    const char *name;
+    uint64_t start;
+} z_trace_span_;
+
+#if defined(Z_TRACE) && (defined(__cplusplus) || Z_HAS_CLEANUP)
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+z_trace_span_ z_trace_begin_(const char *name);
+void z_trace_end_(z_trace_span_ *span);
+#   ifdef __cplusplus
+}
+#   endif
+#   ifdef __cplusplus
+struct z_trace_scope_
+{
+    z_trace_span_ span;
+    explicit z_trace_scope_(const char *name) : span(z_trace_begin_(name)) {}
+    ~z_trace_scope_() { z_trace_end_(&span); }
+};
+#       define Z_TRACE_SCOPE(name) z_trace_scope_ Z_UNIQUE(z_trace_scope_)(name)
+#   else
+#       define Z_TRACE_SCOPE(name) \
+            z_trace_span_ Z_UNIQUE(z_trace_span_) Z_CLEANUP(z_trace_end_) = z_trace_begin_(name)
+#   endif
+#   define Z_HAS_TRACE 1
+#else
+#   define Z_TRACE_SCOPE(name) ((void)0)
+#   define Z_HAS_TRACE 0
+#endif
+
 // Growth strategy.
 
 /* * Determines how containers expand when full.
@@ -123,4 +486,195 @@
     // #define Z_GROWTH_FACTOR(cap) ((cap) == 0 ? 32 : (cap) + (cap) / 2)
 #endif
 
+/* * Size-aware growth policy (z_grow_capacity).
+ * Small buffers follow Z_GROWTH_FACTOR. Once a buffer passes
+ * Z_GROWTH_LARGE_BYTES it grows by 1/Z_GROWTH_LARGE_DIV of its size, rounded
+ * to whole pages, which bounds slack on very large containers while realloc
+ * (mremap-backed on most systems) keeps the moves cheap.
+ */
+#ifndef Z_GROWTH_LARGE_BYTES
+#   define Z_GROWTH_LARGE_BYTES ((size_t)1 << 20)
+#endif
+
+#ifndef Z_GROWTH_LARGE_DIV
+#   define Z_GROWTH_LARGE_DIV 4
+#endif
+
+#ifndef Z_GROWTH_PAGE
+#   define Z_GROWTH_PAGE ((size_t)4096)
+#endif
+
+/* * Returns the capacity (in elements) to grow to so that at least `needed`
+ * elements fit. `hint` is the container's initial capacity when `cap` is 0
+ * (0 = Z_GROWTH_FACTOR(0)). Returns 0 if the byte size would overflow.
+ */
+static inline size_t z_grow_capacity(size_t cap, size_t needed, size_t elem_size, size_t hint)
+{
+    if (0 == elem_size)
+    {
+        elem_size = 1;
+    }
+    size_t max_elems = (size_t)-1 / elem_size;
+    if (needed > max_elems)
+    {
+        return 0;
+    }
+
+    size_t next;
+    if (0 == cap)
+    {
+        next = hint ? hint : (size_t)Z_GROWTH_FACTOR(0);
+    }
+    else if (cap <= Z_GROWTH_LARGE_BYTES / elem_size)
+    {
+        next = (cap > max_elems / 2) ? max_elems : (size_t)Z_GROWTH_FACTOR(cap);
+    }
+    else
+    {
+        size_t bytes = cap * elem_size;
+        size_t step = bytes / Z_GROWTH_LARGE_DIV;
+        if (bytes > (size_t)-1 - step - Z_GROWTH_PAGE)
+        {
+            next = max_elems;
+        }
+        else
+        {
+            bytes = (bytes + step + Z_GROWTH_PAGE - 1) & ~(Z_GROWTH_PAGE - 1);
+            next = bytes / elem_size;
+        }
+    }
+    return next < needed ? needed : next;
+}
+
+/* * Reports how many elements actually fit in a block just returned by
+ * Z_MALLOC/Z_REALLOC, so containers can claim the allocator's slack.
+ * Returns `cap` unchanged unless the backend is the C library and exposes
+ * malloc_usable_size (glibc), malloc_size (Apple) or _msize (MSVC).
+ */
+#if defined(Z_MALLOC_IS_STDLIB) && !defined(Z_NO_USABLE_SIZE)
+#   if defined(__GLIBC__) || defined(__linux__)
+#       include <malloc.h>
+#       define Z_USABLE_SIZE_(p) malloc_usable_size(p)
+#   elif defined(__APPLE__)
+#       include <malloc/malloc.h>
+#       define Z_USABLE_SIZE_(p) malloc_size(p)
+#   elif defined(_MSC_VER)
+#       include <malloc.h>
+#       define Z_USABLE_SIZE_(p) _msize(p)
+#   endif
+#endif
+
+static inline size_t z_usable_capacity(void *ptr, size_t cap, size_t elem_size)
+{
+#ifdef Z_USABLE_SIZE_
+    if (ptr && elem_size)
+    {
+        size_t fit = (size_t)Z_USABLE_SIZE_(ptr) / elem_size;
+        return fit > cap ? fit : cap;
+    }
+#else
+    (void)ptr; (void)elem_size;
+#endif
+    return cap;
+}
+
+// Small-buffer storage.
+
+/* * Inline storage for the first N elements, spilling to the heap beyond that:
+ *
+ *   typedef struct { Z_SMALL_STORAGE(int, 16); size_t length; } small_ints;
+ *
+ * The heap pointer shares a union with the inline array and `sbo_cap` says
+ * which one is live (0 = inline). Nothing points into the struct itself, so
+ * it can be moved with memcpy, returned by value, and zero-initialised into
+ * a valid empty container. Elements must be trivially copyable.
+ */
+#define Z_SMALL_STORAGE(T, N)       union { T *heap; T buf[N]; } sbo; size_t sbo_cap
+
+#define Z_SMALL_INLINE_CAP(c)       (sizeof((c).sbo.buf) / sizeof((c).sbo.buf[0]))
+#define Z_SMALL_IS_INLINE(c)        (0 == (c).sbo_cap)
+#define Z_SMALL_DATA(c)             ((c).sbo_cap ? (c).sbo.heap : (c).sbo.buf)
+#define Z_SMALL_CAPACITY(c)         ((c).sbo_cap ? (c).sbo_cap : Z_SMALL_INLINE_CAP(c))
+
+// Makes room for `needed` elements, keeping the first `len`. Z_OK or Z_ENOMEM.
+#define Z_SMALL_RESERVE(c, len, needed) \
+    z_small_reserve(&(c).sbo, &(c).sbo_cap, Z_SMALL_INLINE_CAP(c), (len), (needed), sizeof((c).sbo.buf[0]))
+
+// Moves the first `len` elements back inline (and frees the block) if they fit.
+#define Z_SMALL_SHRINK(c, len) \
+    z_small_shrink(&(c).sbo, &(c).sbo_cap, Z_SMALL_INLINE_CAP(c), (len), sizeof((c).sbo.buf[0]))
+
+#define Z_SMALL_FREE(c)             z_small_free(&(c).sbo, &(c).sbo_cap)
+
+// Frees `dst`'s heap block, then transfers `src`'s storage (heap block
+// included) and leaves `src` empty and inline. `dst` and `src` must differ.
+#define Z_SMALL_MOVE(dst, src) \
+    (z_small_free(&(dst).sbo, &(dst).sbo_cap), \
+     memcpy(&(dst).sbo, &(src).sbo, sizeof((src).sbo)), (dst).sbo_cap = (src).sbo_cap, (src).sbo_cap = 0)
+
+/* * The heap pointer is read and written with memcpy: these helpers see the
+ * union as bytes, whatever T is.
+ */
+static inline int z_small_reserve(void *sbo, size_t *heap_cap, size_t inline_cap, size_t len,
+                                  size_t needed, size_t elem_size)
+{
+    size_t cap = *heap_cap ? *heap_cap : inline_cap;
+    if (Z_LIKELY(needed <= cap))
+    {
+        return Z_OK;
+    }
+    size_t next = z_grow_capacity(cap, needed, elem_size, 0);
+    if (0 == next)
+    {
+        return Z_ENOMEM;
+    }
+    void *block;
+    if (*heap_cap)
+    {
+        void *old;
+        memcpy(&old, sbo, sizeof(old));
+        block = Z_REALLOC(old, next * elem_size);
+        if (!block)
+        {
+            return Z_ENOMEM;
+        }
+    }
+    else
+    {
+        // First spill: copy out before the pointer overwrites the inline bytes.
+        block = Z_MALLOC(next * elem_size);
+        if (!block)
+        {
+            return Z_ENOMEM;
+        }
+        memcpy(block, sbo, len * elem_size);
+    }
+    memcpy(sbo, &block, sizeof(block));
+    *heap_cap = z_usable_capacity(block, next, elem_size);
+    return Z_OK;
+}
+
+static inline void z_small_shrink(void *sbo, size_t *heap_cap, size_t inline_cap, size_t len, size_t elem_size)
+{
+    if (*heap_cap && len <= inline_cap)
+    {
+        void *block;
+        memcpy(&block, sbo, sizeof(block));
+        memcpy(sbo, block, len * elem_size);
+        Z_FREE(block);
+        *heap_cap = 0;
+    }
+}
+
+static inline void z_small_free(void *sbo, size_t *heap_cap)
+{
+    if (*heap_cap)
+    {
+        void *block;
+        memcpy(&block, sbo, sizeof(block));
+        Z_FREE(block);
+        *heap_cap = 0;
+    }
+}
+
 #endif // ZCOMMON_H
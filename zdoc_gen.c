@@ -3,8 +3,25 @@
 #include "zstr.h"
 #define ZFILE_IMPLEMENTATION
 #include "zfile.h"
+#define ZSIMD_IMPLEMENTATION
+#include "zsimd.h"
+#define ZSLAB_IMPLEMENTATION
+#include "zslab.h"
+#define ZTASK_IMPLEMENTATION
+#include "ztask.h"
+#include "zhash.h"
 #include <ctype.h>
 
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <dirent.h>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
 const char *DEFAULT_OUT = "README.md";
 const char *MARKER_START = "[//]: # (ZDOC_START)";
 const char *MARKER_END   = "[//]: # (ZDOC_END)";
@@ -17,6 +34,169 @@ typedef enum {
     MODE_ENUM     // Values.
 } DocMode;
 
+// Input.
+
+/* * A whole input file, memory-mapped when possible. Every line, directive
+ * argument and declaration is a zstr_view into it; only output is copied.
+ */
+typedef struct {
+    const char *data;
+    size_t len;
+    void *map;      // Mapping to release, if mapped.
+    char *owned;    // Heap copy, if the file could not be mapped.
+} DocInput;
+
+bool doc_input_read(DocInput *in, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    size_t cap = 1 << 16;
+    size_t len = 0;
+    char *buf = (char *)malloc(cap);
+    size_t got;
+    while (buf && (got = fread(buf + len, 1, cap - len, f)) > 0)
+    {
+        len += got;
+        if (len == cap)
+        {
+            char *grown = (char *)realloc(buf, cap * 2);
+            if (!grown)
+            {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    in->data = buf;
+    in->len = len;
+    in->owned = buf;
+    return NULL != buf;
+}
+
+bool doc_input_open(DocInput *in, const char *path)
+{
+    in->data = "";
+    in->len = 0;
+    in->map = NULL;
+    in->owned = NULL;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == file)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (FILE_TYPE_DISK != GetFileType(file))
+    {
+        CloseHandle(file);
+        return doc_input_read(in, path);
+    }
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    if (0 == size.QuadPart)
+    {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping)
+    {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (view)
+    {
+        in->map = view;
+        in->data = (const char *)view;
+        in->len = (size_t)size.QuadPart;
+        return true;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (0 != fstat(fd, &st))
+    {
+        close(fd);
+        return false;
+    }
+    // Pipes and procfs files report no size; only a regular file is really empty.
+    if (!S_ISREG(st.st_mode) || 0 == st.st_size)
+    {
+        close(fd);
+        return S_ISREG(st.st_mode) || doc_input_read(in, path);
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED != view)
+    {
+#   ifdef MADV_SEQUENTIAL
+        madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+#   endif
+        in->map = view;
+        in->data = (const char *)view;
+        in->len = (size_t)st.st_size;
+        return true;
+    }
+#endif
+    // Pipes, special files or no address space left: read it instead.
+    return doc_input_read(in, path);
+}
+
+void doc_input_close(DocInput *in)
+{
+    if (in->map)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(in->map);
+#else
+        munmap(in->map, in->len);
+#endif
+    }
+    free(in->owned);
+    in->map = NULL;
+    in->owned = NULL;
+}
+
+// Content hash as 16 hex digits; this is what stamps record.
+void doc_hash_hex(const char *data, size_t len, char out[17])
+{
+    snprintf(out, 17, "%016llx", (unsigned long long)z_hash_bytes(data, len, 0));
+}
+
+// Hash of a file's bytes, or "-" if it cannot be read.
+void doc_hash_file(const char *path, char out[17])
+{
+    DocInput in;
+    if (!doc_input_open(&in, path))
+    {
+        strcpy(out, "-");
+        return;
+    }
+    doc_hash_hex(in.data, in.len, out);
+    doc_input_close(&in);
+}
+
+bool doc_next_line(const char **cur, const char *end, zstr_view *line)
+{
+    return z_next_line(cur, end, &line->data, &line->len);
+}
+
 // Helpers.
 
 bool is_code_decl(zstr_view line, DocMode mode) 
@@ -98,23 +278,101 @@ bool is_incomplete(zstr_view line, DocMode mode)
     return (last != ';' && last != '{' && last != ',');
 }
 
-zstr clean_signature(zstr_view line) 
+bool is_ident_char(char c)
+{
+    return isalnum((unsigned char)c) || '_' == c;
+}
+
+bool word_is(const char *p, size_t n, const char *word)
+{
+    return strlen(word) == n && 0 == memcmp(p, word, n);
+}
+
+/* * Appends the documented form of a declaration in one pass over `decl`,
+ * which may span several input lines: `//` comments and line continuations
+ * are dropped, whitespace runs become one space, the `static inline`,
+ * `extern`, `Z_NODISCARD` and `typedef` keywords are removed and a final
+ * `;`, `{` or `,` is cut.
+ */
+void append_signature(zstr *out, zstr_view decl)
 {
-    zstr s = zstr_from_view(line);
-    zstr_trim(&s); 
-    if (zstr_ends_with(&s, ";") || 
-        zstr_ends_with(&s, "{") || 
-        zstr_ends_with(&s, ",")) 
+    const char *p = decl.data;
+    const char *end = decl.data + decl.len;
+    size_t start = zstr_len(out);
+    size_t static_at = (size_t)-1;
+    bool space = false;
+
+    while (p < end)
     {
-        zstr_pop_char(&s);
+        char c = *p;
+        if ('/' == c && p + 1 < end && '/' == p[1])
+        {
+            while (p < end && '\n' != *p)
+            {
+                p++;
+            }
+            continue;
+        }
+        if (isspace((unsigned char)c) || '\\' == c)
+        {
+            space = zstr_len(out) > start;
+            p++;
+            continue;
+        }
+        if (is_ident_char(c))
+        {
+            const char *w = p;
+            while (p < end && is_ident_char(*p))
+            {
+                p++;
+            }
+            size_t n = (size_t)(p - w);
+            if (word_is(w, n, "inline") && (size_t)-1 != static_at)
+            {
+                // Drop the `static ` written just before.
+                while (zstr_len(out) > static_at)
+                {
+                    zstr_pop_char(out);
+                }
+                static_at = (size_t)-1;
+                space = zstr_len(out) > start;
+                continue;
+            }
+            if (word_is(w, n, "extern") || word_is(w, n, "Z_NODISCARD") || word_is(w, n, "typedef"))
+            {
+                continue;
+            }
+            if (space)
+            {
+                zstr_push(out, ' ');
+                space = false;
+            }
+            static_at = word_is(w, n, "static") ? zstr_len(out) : (size_t)-1;
+            zstr_cat_len(out, w, n);
+            continue;
+        }
+        if (space)
+        {
+            zstr_push(out, ' ');
+            space = false;
+        }
+        static_at = (size_t)-1;
+        zstr_push(out, c);
+        p++;
+    }
+
+    if (zstr_len(out) > start)
+    {
+        char last = zstr_data(out)[zstr_len(out) - 1];
+        if (';' == last || '{' == last || ',' == last)
+        {
+            zstr_pop_char(out);
+            while (zstr_len(out) > start && ' ' == zstr_data(out)[zstr_len(out) - 1])
+            {
+                zstr_pop_char(out);
+            }
+        }
     }
-    zstr_replace(&s, "\\", ""); 
-    zstr_replace(&s, "static inline ", "");
-    zstr_replace(&s, "extern ", "");
-    zstr_replace(&s, "Z_NODISCARD ", "");
-    zstr_replace(&s, "typedef ", "");
-    zstr_trim(&s);
-    return s;
 }
 
 zstr_view strip_decorative_star(zstr_view v) 
@@ -146,375 +404,746 @@ zstr make_anchor(zstr_view title)
     return s;
 }
 
-int main(int argc, char **argv) 
-{
-    if (argc < 2) 
-    {
-        printf("Usage: zdoc_gen <header> [output] [template]\n");
-        return 1;
-    }
+// Symbols.
 
-    const char *input_path = argv[1];
-    const char *out_path = (argc > 2) ? argv[2] : DEFAULT_OUT;
-    const char *tpl_path = (argc > 3) ? argv[3] : NULL;
+typedef enum {
+    SYM_FUNCTION,
+    SYM_MACRO,
+    SYM_FIELD,
+    SYM_VALUE
+} DocSymbolKind;
 
-    if (!zfile_exists(input_path)) 
+const char *DOC_SYMBOL_KINDS[] = {"function", "macro", "field", "value"};
+
+// Every string is an offset into the pool; 0 is the empty string.
+typedef struct {
+    uint32_t name;
+    uint32_t kind;
+    uint32_t scope;             // Struct, enum or group the symbol belongs to.
+    uint32_t signature;         // As rendered in the Markdown table.
+    uint32_t summary;           // Description, without directives.
+    uint32_t params;            // One @param per line.
+    uint32_t returns;
+    uint32_t flags;
+} DocSymbol;
+
+#define DOC_SYM_DEPRECATED 1u
+
+typedef struct {
+    DocSymbol *items;
+    size_t count;
+    size_t cap;
+    zstr pool;                  // NUL-terminated strings, starting with "".
+} DocSymbols;
+
+uint32_t doc_pool_add(zstr *pool, zstr_view s)
+{
+    if (0 == s.len)
     {
-        return 1;
+        return 0;
     }
-    
-    zstr doc_content = zstr_init();
-    zstr toc_content = zstr_init();
-    zstr issues_content = zstr_init();
-    zstr pending_desc = zstr_init();
-    zstr current_columns = zstr_from("Function | Description");
-    
-    DocMode mode = MODE_TEXT; 
-    bool in_block_comment = false;
-    bool in_example = false;
-    bool skip_next = false;
-    bool is_private = false;
-
-    zfile_reader reader = zfile_reader_open(input_path);
-    zstr_view raw_line;
+    uint32_t at = (uint32_t)zstr_len(pool);
+    zstr_cat_len(pool, s.data, s.len);
+    zstr_push(pool, '\0');
+    return at;
+}
 
-    while (zfile_reader_next_line(&reader, &raw_line)) 
+/* * The declared name: the macro after #define, the identifier after `(*` for
+ * function pointers, otherwise the one before the parameter list (functions),
+ * the last one before `;`, `[` or `:` (fields) or the first one (values).
+ */
+zstr_view symbol_name(zstr_view decl, DocSymbolKind kind)
+{
+    const char *p = decl.data;
+    const char *end = decl.data + decl.len;
+    const char *ptr = (SYM_FUNCTION == kind || SYM_FIELD == kind) ? z_memmem(p, decl.len, "(*", 2) : NULL;
+    if (SYM_MACRO == kind)
     {
-        zstr_view line = zstr_view_trim(raw_line);
-        if (0 == line.len && !in_block_comment) 
+        p += strlen("#define");
+        while (p < end && !is_ident_char(*p))
         {
-            continue;
+            p++;
         }
-
-        zstr_view content = {NULL, 0};
-        zstr_view raw_content = {NULL, 0};
-        bool is_doc_line = false;
-
-        if (!in_block_comment && zstr_view_starts_with(line, "///")) 
-        {
-            raw_content = zstr_sub(line, 3, line.len - 3);
-            content = zstr_view_trim(raw_content);
-            is_doc_line = true;
-        } 
-        else if (!in_block_comment && zstr_view_starts_with(line, "/**")) 
-        {
-            in_block_comment = true;
-            size_t offset = (line.len > 2 && '*' == line.data[2]) ? 3 : 2;
-            content = zstr_view_trim(zstr_sub(line, offset, line.len - offset));
-            if (zstr_view_ends_with(content, "*/")) 
-            {
-                content.len -= 2; 
-                content = zstr_view_trim(content); 
-                in_block_comment = false;
-            }
-            content = strip_decorative_star(content);
-            is_doc_line = true;
-        } 
-        else if (in_block_comment) 
+    }
+    else if (ptr)
+    {
+        p = ptr + 2;
+        while (p < end && ' ' == *p)
         {
-            content = line;
-            if (zstr_view_ends_with(content, "*/")) 
-            {
-                content.len -= 2; 
-                in_block_comment = false;
-            }
-            content = strip_decorative_star(content);
-            is_doc_line = true;
+            p++;
         }
-
-        if (is_doc_line) 
+    }
+    else if (SYM_VALUE != kind)
+    {
+        const char *stop = (const char *)memchr(p, SYM_FUNCTION == kind ? '(' : ';', decl.len);
+        if (SYM_FIELD == kind)
         {
-            if (in_example) 
-            {
-                if (zstr_view_starts_with(content, "@endexample")) 
-                {
-                    zstr *target = (MODE_TEXT != mode) ? &pending_desc : &doc_content;
-                    if (MODE_TEXT != mode) 
-                    {
-                        zstr_cat(target, "</code>");
-                    }
-                    else 
-                    {
-                        zstr_cat(target, "```\n");
-                    }
-                    in_example = false;
-                } 
-                else 
-                {
-                    zstr_view code_line = raw_content;
-                    if (code_line.len > 0 && ' ' == code_line.data[0])
-                    {
-                        code_line = zstr_sub(code_line, 1, code_line.len - 1);
-                    }
-                    zstr *target = (MODE_TEXT != mode) ? &pending_desc : &doc_content;
-                    if (MODE_TEXT != mode) 
-                    {
-                        if (!zstr_ends_with(target, "<code>")) 
-                        {
-                            zstr_push(target, ' ');
-                        }
-                         zstr_cat_len(target, code_line.data, code_line.len);
-                    } 
-                    else 
-                    {
-                        zstr_cat_len(target, code_line.data, code_line.len);
-                        zstr_push(target, '\n');
-                    }
-                }
-                continue;
-            }
-
-            if (zstr_view_starts_with(content, "@section") || 
-                zstr_view_starts_with(content, "@group")) 
-            {
-                bool is_group = zstr_view_starts_with(content, "@group");
-                zstr_view title = zstr_view_trim(zstr_sub(content, (is_group ? 6 : 8), content.len - (is_group ? 6 : 8)));
-                zstr_fmt(&doc_content, "\n## %.*s\n\n", ZSV_ARG(title));
-                zstr anchor = make_anchor(title);
-                zstr_fmt(&toc_content, "* [%.*s](%s)\n", ZSV_ARG(title), zstr_cstr(&anchor));
-                zstr_free(&anchor);
-                if (is_group) 
-                {
-                    zstr_fmt(&doc_content, "| Function | Description |\n|---|---|\n");
-                    mode = MODE_TABLE; 
-                } 
-                else 
-                {
-                    mode = MODE_TEXT; 
-                }
-                zstr_clear(&pending_desc);
-            }
-            else if (zstr_view_starts_with(content, "@subsection")) 
-            {
-                zstr_view title = zstr_view_trim(zstr_sub(content, 11, content.len - 11));
-                zstr_fmt(&doc_content, "\n### %.*s\n\n", ZSV_ARG(title));
-                mode = MODE_TEXT; 
-                zstr_clear(&pending_desc);
-            }
-            else if (zstr_view_starts_with(content, "@endgroup")) 
-            { 
-                mode = MODE_TEXT; 
-            }
-            else if (zstr_view_starts_with(content, "@struct")) 
-            {
-                zstr_view name = zstr_view_trim(zstr_sub(content, 7, content.len - 7));
-                zstr_fmt(&doc_content, "\n### struct %.*s\n\n", ZSV_ARG(name));
-                zstr_cat(&doc_content, "| Field | Type/Description |\n|---|---|\n");
-                mode = MODE_STRUCT; 
-                zstr_clear(&pending_desc);
-            }
-            else if (zstr_view_starts_with(content, "@enum")) 
-            {
-                zstr_view name = zstr_view_trim(zstr_sub(content, 5, content.len - 5));
-                zstr_fmt(&doc_content, "\n### enum %.*s\n\n", ZSV_ARG(name));
-                zstr_cat(&doc_content, "| Value | Description |\n|---|---|\n");
-                mode = MODE_ENUM; zstr_clear(&pending_desc);
-            }
-            else if (zstr_view_starts_with(content, "@table")) 
-            {
-                zstr_view title = zstr_view_trim(zstr_sub(content, 6, content.len - 6));
-                zstr_fmt(&doc_content, "\n**%.*s**\n\n", ZSV_ARG(title));
-                zstr_fmt(&doc_content, "| %s |\n", zstr_cstr(&current_columns));
-                zstr_cat(&doc_content, "|");
-                zstr_view cols_v = zstr_view_from(zstr_cstr(&current_columns));
-                zstr_split_iter it = zstr_split_init(cols_v, "|");
-                zstr_view part;
-                while(zstr_split_next(&it, &part)) 
-                {
-                    zstr_cat(&doc_content, "---|");
-                }
-                zstr_cat(&doc_content, "\n");
-                mode = MODE_TABLE; zstr_clear(&pending_desc);
-            }
-            else if (zstr_view_starts_with(content, "@columns")) 
-            {
-                zstr_view cols = zstr_view_trim(zstr_sub(content, 8, content.len - 8));
-                zstr_free(&current_columns); 
-                current_columns = zstr_from_view(cols);
-            }
-            else if (zstr_view_starts_with(content, "@row")) 
-            {
-                zstr_view row = zstr_view_trim(zstr_sub(content, 4, content.len - 4));
-                zstr_fmt(&doc_content, "| %.*s |\n", ZSV_ARG(row));
-            }
-            else if (zstr_view_starts_with(content, "@separator")) 
-            {
-                zstr_cat(&doc_content, "\n---\n");
-            }
-            else if (zstr_view_starts_with(content, "@skip")) 
-            {
-                skip_next = true;
-            }
-            else if (zstr_view_starts_with(content, "@private")) {
-                is_private = true;
-            }
-            else if (zstr_view_starts_with(content, "@deprecated")) 
-            {
-                if (zstr_len(&pending_desc) > 0) 
-                {
-                    zstr_cat(&pending_desc, "<br>");
-                }
-                zstr_cat(&pending_desc, "**Deprecated**");
-            }
-            else if (zstr_view_starts_with(content, "@param")) 
-            {
-                zstr_view param = zstr_view_trim(zstr_sub(content, 6, content.len - 6));
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(&pending_desc) > 0) 
-                    {
-                        zstr_cat(&pending_desc, "<br>");
-                    }
-                    zstr_fmt(&pending_desc, "**Param**: %.*s", ZSV_ARG(param));
-                }
-            }
-            else if (zstr_view_starts_with(content, "@return")) 
-            {
-                zstr_view ret = zstr_view_trim(zstr_sub(content, 7, content.len - 7));
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(&pending_desc) > 0) 
-                    {
-                        zstr_cat(&pending_desc, "<br>");
-                    }
-                    zstr_fmt(&pending_desc, "**Returns**: %.*s", ZSV_ARG(ret));
-                }
-            }
-            else if (zstr_view_starts_with(content, "@warn")) 
-            {
-                zstr_view msg = zstr_view_trim(zstr_sub(content, 5, content.len - 5));
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(&pending_desc) > 0) 
-                    {
-                        zstr_cat(&pending_desc, "<br>");
-                    }
-                    zstr_fmt(&pending_desc, "**Warning**: %.*s", ZSV_ARG(msg));
-                } 
-                else 
-                {
-                    zstr_fmt(&doc_content, "> **Warning**: %.*s\n", ZSV_ARG(msg));
-                }
-            }
-            else if (zstr_view_starts_with(content, "@note")) 
-            {
-                zstr_view msg = zstr_view_trim(zstr_sub(content, 5, content.len - 5));
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(&pending_desc) > 0) 
-                    {
-                        zstr_cat(&pending_desc, "<br>");
-                    }
-                    zstr_fmt(&pending_desc, "**Note**: %.*s", ZSV_ARG(msg));
-                } 
-                else 
-                {
-                    zstr_fmt(&doc_content, "> **Note**: %.*s\n", ZSV_ARG(msg));
-                }
-            }
-            else if (zstr_view_starts_with(content, "@todo")) 
-            {
-                zstr_view msg = zstr_view_trim(zstr_sub(content, 5, content.len - 5));
-                zstr_fmt(&issues_content, "* [TODO] %.*s\n", ZSV_ARG(msg));
-            }
-            else if (zstr_view_starts_with(content, "@bug")) 
-            {
-                zstr_view msg = zstr_view_trim(zstr_sub(content, 4, content.len - 4));
-                zstr_fmt(&issues_content, "* [BUG] %.*s\n", ZSV_ARG(msg));
-            }
-            else if (zstr_view_starts_with(content, "@include")) 
-            {
-                zstr_view path = zstr_view_trim(zstr_sub(content, 8, content.len - 8));
-                zstr inc_data = zfile_read_all(zstr_from_view(path).s.buf); 
-                zstr_cat(&doc_content, zstr_cstr(&inc_data)); 
-                zstr_push(&doc_content, '\n'); 
-                zstr_free(&inc_data);
-            }
-            else if (zstr_view_starts_with(content, "@raw")) 
-            {
-                zstr_view raw = zstr_sub(content, 4, content.len - 4);
-                zstr_cat_len(&doc_content, raw.data, raw.len); 
-                zstr_push(&doc_content, '\n');
-            }
-            else if (zstr_view_starts_with(content, "@example")) 
-            {
-                zstr_view lang = zstr_view_trim(zstr_sub(content, 8, content.len - 8));
-                if (0 == lang.len) 
-                {
-                    lang = zstr_view_from("c"); 
-                }
-                zstr *target = (MODE_TEXT != mode) ? &pending_desc : &doc_content;
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(target) > 0) 
-                    {
-                        zstr_cat(target, "<br>");
-                    }
-                    zstr_cat(target, "**Example**: <code>");
-                } 
-                else 
-                {
-                    zstr_fmt(target, "\n```%.*s\n", ZSV_ARG(lang));
-                }
-                in_example = true;
-            }
-            else 
+            for (const char *q = p; q < (stop ? stop : end); q++)
             {
-                if (MODE_TEXT != mode) 
-                {
-                    if (zstr_len(&pending_desc) > 0) 
-                    {
-                        zstr_push(&pending_desc, ' ');
-                    }
-                    zstr_cat_len(&pending_desc, content.data, content.len);
-                } 
-                else 
+                if ('[' == *q || ':' == *q)
                 {
-                    zstr_fmt(&doc_content, "%.*s\n", ZSV_ARG(content));
+                    stop = q;
+                    break;
                 }
             }
-            continue;
         }
-
-        if (MODE_TEXT != mode && !in_block_comment) 
+        const char *q = stop ? stop : end;
+        while (q > p && !is_ident_char(q[-1]))
         {
-            if (skip_next || is_private) 
-            { 
-                skip_next = false; 
-                is_private = false; 
-                zstr_clear(&pending_desc); 
-                continue; 
-            }
-            zstr_split_iter it = zstr_split_init(line, "//");
-            zstr_view code_part = {0};
-            zstr_split_next(&it, &code_part);
-            code_part = zstr_view_trim(code_part);
-            if (!is_code_decl(code_part, mode)) 
-            {
-                continue;
-            }
-            zstr full_decl = zstr_from_view(code_part);
-            while (is_incomplete(zstr_as_view(&full_decl), mode)) 
-            {
+            q--;
+        }
+        end = q;
+        while (q > p && is_ident_char(q[-1]))
+        {
+            q--;
+        }
+        p = q;
+    }
+    const char *q = p;
+    while (q < end && is_ident_char(*q))
+    {
+        q++;
+    }
+    zstr_view name = {p, (size_t)(q - p)};
+    return name;
+}
+
+// Directives.
+
+typedef struct {
+    zstr doc;                   // Generated Markdown.
+    zstr toc;                   // One link per @section / @group.
+    zstr issues;                // @todo and @bug entries.
+    zstr pending;               // Description of the next declaration.
+    zstr deps;                  // "<hash> <path>" per @include, for stamps and depfiles.
+    char hash[17];              // Of the header itself.
+    DocSymbols *symbols;        // NULL unless a symbol database was requested.
+    zstr_view scope;            // Current group, struct or enum.
+    zstr summary;               // Plain description of the next declaration,
+    zstr params;                // its @param lines,
+    zstr returns;               // its @return text
+    bool deprecated;            // and whether it is @deprecated.
+    zstr_view columns;          // Header of the next @table.
+    DocMode mode;
+    bool in_block_comment;
+    bool in_example;
+    bool skip_next;
+    bool is_private;
+    bool want_toc;
+} DocState;
+
+typedef struct {
+    zstr_view content;          // Whole comment text.
+    zstr_view arg;              // Text after the directive, trimmed.
+    zstr_view raw;              // Text after the directive, as written.
+} DocLine;
+
+typedef enum {
+    DIR_TEXT,                   // Not a directive: description or prose.
+    DIR_TOC,
+    DIR_SECTION,
+    DIR_SUBSECTION,
+    DIR_GROUP,
+    DIR_ENDGROUP,
+    DIR_SEPARATOR,
+    DIR_STRUCT,
+    DIR_ENUM,
+    DIR_TABLE,
+    DIR_COLUMNS,
+    DIR_ROW,
+    DIR_PARAM,
+    DIR_RETURN,
+    DIR_PRIVATE,
+    DIR_SKIP,
+    DIR_EXAMPLE,
+    DIR_ENDEXAMPLE,
+    DIR_INCLUDE,
+    DIR_RAW,
+    DIR_WARN,
+    DIR_NOTE,
+    DIR_DEPRECATED,
+    DIR_BUG,
+    DIR_TODO,
+    DIR_RETURNS,                // Alias of @return.
+    DIR_WARNING,                // Alias of @warn.
+    DIR_COUNT
+} DocDirective;
+
+DocState doc_state_init(void)
+{
+    DocState st;
+    st.doc = zstr_init();
+    st.toc = zstr_init();
+    st.issues = zstr_init();
+    st.pending = zstr_init();
+    st.deps = zstr_init();
+    st.symbols = NULL;
+    st.scope.data = NULL;
+    st.scope.len = 0;
+    st.summary = zstr_init();
+    st.params = zstr_init();
+    st.returns = zstr_init();
+    st.deprecated = false;
+    st.columns = zstr_view_from("Function | Description");
+    st.mode = MODE_TEXT;
+    st.in_block_comment = false;
+    st.in_example = false;
+    st.skip_next = false;
+    st.is_private = false;
+    st.want_toc = false;
+    strcpy(st.hash, "-");
+    return st;
+}
+
+void doc_state_free(DocState *st)
+{
+    zstr_free(&st->doc);
+    zstr_free(&st->toc);
+    zstr_free(&st->issues);
+    zstr_free(&st->pending);
+    zstr_free(&st->deps);
+    zstr_free(&st->summary);
+    zstr_free(&st->params);
+    zstr_free(&st->returns);
+}
+
+// Forgets everything said about the next declaration.
+void clear_pending(DocState *st)
+{
+    zstr_clear(&st->pending);
+    zstr_clear(&st->summary);
+    zstr_clear(&st->params);
+    zstr_clear(&st->returns);
+    st->deprecated = false;
+}
+
+void record_symbol(DocState *st, zstr_view decl, zstr_view signature)
+{
+    DocSymbols *syms = st->symbols;
+    if (syms->count == syms->cap)
+    {
+        size_t cap = syms->cap ? syms->cap * 2 : 64;
+        DocSymbol *grown = (DocSymbol *)realloc(syms->items, cap * sizeof(DocSymbol));
+        if (!grown)
+        {
+            return;
+        }
+        syms->items = grown;
+        syms->cap = cap;
+    }
+    DocSymbolKind kind = zstr_view_starts_with(decl, "#define") ? SYM_MACRO
+                       : MODE_STRUCT == st->mode                ? SYM_FIELD
+                       : MODE_ENUM == st->mode                  ? SYM_VALUE
+                                                                : SYM_FUNCTION;
+    DocSymbol *sym = &syms->items[syms->count++];
+    sym->name = doc_pool_add(&syms->pool, symbol_name(decl, kind));
+    sym->kind = (uint32_t)kind;
+    sym->scope = doc_pool_add(&syms->pool, st->scope);
+    sym->signature = doc_pool_add(&syms->pool, signature);
+    sym->summary = doc_pool_add(&syms->pool, zstr_as_view(&st->summary));
+    sym->params = doc_pool_add(&syms->pool, zstr_as_view(&st->params));
+    sym->returns = doc_pool_add(&syms->pool, zstr_as_view(&st->returns));
+    sym->flags = st->deprecated ? DOC_SYM_DEPRECATED : 0;
+}
+
+// Where rich content goes: the pending table cell, or the document itself.
+zstr *doc_target(DocState *st)
+{
+    return (MODE_TEXT != st->mode) ? &st->pending : &st->doc;
+}
+
+void pending_break(DocState *st)
+{
+    if (zstr_len(&st->pending) > 0)
+    {
+        zstr_cat(&st->pending, "<br>");
+    }
+}
+
+void on_text(DocState *st, const DocLine *l)
+{
+    if (MODE_TEXT != st->mode)
+    {
+        if (zstr_len(&st->pending) > 0)
+        {
+            zstr_push(&st->pending, ' ');
+        }
+        zstr_cat_len(&st->pending, l->content.data, l->content.len);
+        if (zstr_len(&st->summary) > 0)
+        {
+            zstr_push(&st->summary, ' ');
+        }
+        zstr_cat_len(&st->summary, l->content.data, l->content.len);
+    }
+    else
+    {
+        zstr_fmt(&st->doc, "%.*s\n", ZSV_ARG(l->content));
+    }
+}
+
+void on_toc(DocState *st, const DocLine *l)
+{
+    (void)l;
+    st->want_toc = true;
+    if (MODE_TEXT == st->mode)
+    {
+        zstr_push(&st->doc, '\n');
+    }
+}
+
+void begin_section(DocState *st, zstr_view title, bool is_group)
+{
+    st->scope = title;
+    zstr_fmt(&st->doc, "\n## %.*s\n\n", ZSV_ARG(title));
+    zstr anchor = make_anchor(title);
+    zstr_fmt(&st->toc, "* [%.*s](%s)\n", ZSV_ARG(title), zstr_cstr(&anchor));
+    zstr_free(&anchor);
+    if (is_group)
+    {
+        zstr_fmt(&st->doc, "| Function | Description |\n|---|---|\n");
+        st->mode = MODE_TABLE;
+    }
+    else
+    {
+        st->mode = MODE_TEXT;
+    }
+    clear_pending(st);
+}
+
+void on_section(DocState *st, const DocLine *l)
+{
+    begin_section(st, l->arg, false);
+}
+
+void on_group(DocState *st, const DocLine *l)
+{
+    begin_section(st, l->arg, true);
+}
+
+void on_subsection(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->doc, "\n### %.*s\n\n", ZSV_ARG(l->arg));
+    st->mode = MODE_TEXT;
+    clear_pending(st);
+}
+
+void on_endgroup(DocState *st, const DocLine *l)
+{
+    (void)l;
+    st->mode = MODE_TEXT;
+}
+
+void on_separator(DocState *st, const DocLine *l)
+{
+    (void)l;
+    zstr_cat(&st->doc, "\n---\n");
+}
+
+void on_struct(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->doc, "\n### struct %.*s\n\n", ZSV_ARG(l->arg));
+    st->scope = l->arg;
+    zstr_cat(&st->doc, "| Field | Type/Description |\n|---|---|\n");
+    st->mode = MODE_STRUCT;
+    clear_pending(st);
+}
+
+void on_enum(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->doc, "\n### enum %.*s\n\n", ZSV_ARG(l->arg));
+    st->scope = l->arg;
+    zstr_cat(&st->doc, "| Value | Description |\n|---|---|\n");
+    st->mode = MODE_ENUM;
+    clear_pending(st);
+}
+
+void on_table(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->doc, "\n**%.*s**\n\n", ZSV_ARG(l->arg));
+    st->scope = l->arg;
+    zstr_fmt(&st->doc, "| %.*s |\n", ZSV_ARG(st->columns));
+    zstr_cat(&st->doc, "|");
+    zstr_split_iter it = zstr_split_init(st->columns, "|");
+    zstr_view part;
+    while (zstr_split_next(&it, &part))
+    {
+        zstr_cat(&st->doc, "---|");
+    }
+    zstr_cat(&st->doc, "\n");
+    st->mode = MODE_TABLE;
+    clear_pending(st);
+}
+
+void on_columns(DocState *st, const DocLine *l)
+{
+    st->columns = l->arg;
+}
+
+void on_row(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->doc, "| %.*s |\n", ZSV_ARG(l->arg));
+}
+
+void on_param(DocState *st, const DocLine *l)
+{
+    if (MODE_TEXT != st->mode)
+    {
+        pending_break(st);
+        zstr_fmt(&st->pending, "**Param**: %.*s", ZSV_ARG(l->arg));
+        zstr_fmt(&st->params, "%.*s\n", ZSV_ARG(l->arg));
+    }
+}
+
+void on_return(DocState *st, const DocLine *l)
+{
+    if (MODE_TEXT != st->mode)
+    {
+        pending_break(st);
+        zstr_fmt(&st->pending, "**Returns**: %.*s", ZSV_ARG(l->arg));
+        zstr_cat_len(&st->returns, l->arg.data, l->arg.len);
+    }
+}
+
+void on_private(DocState *st, const DocLine *l)
+{
+    (void)l;
+    st->is_private = true;
+}
+
+void on_skip(DocState *st, const DocLine *l)
+{
+    (void)l;
+    st->skip_next = true;
+}
+
+void on_example(DocState *st, const DocLine *l)
+{
+    zstr_view lang = (0 == l->arg.len) ? zstr_view_from("c") : l->arg;
+    zstr *target = doc_target(st);
+    if (MODE_TEXT != st->mode)
+    {
+        pending_break(st);
+        zstr_cat(target, "**Example**: <code>");
+    }
+    else
+    {
+        zstr_fmt(target, "\n```%.*s\n", ZSV_ARG(lang));
+    }
+    st->in_example = true;
+}
+
+void on_endexample(DocState *st, const DocLine *l)
+{
+    if (!st->in_example)
+    {
+        on_text(st, l);
+        return;
+    }
+    if (MODE_TEXT != st->mode)
+    {
+        zstr_cat(&st->pending, "</code>");
+    }
+    else
+    {
+        zstr_cat(&st->doc, "```\n");
+    }
+    st->in_example = false;
+}
+
+void on_example_line(DocState *st, zstr_view code_line)
+{
+    if (code_line.len > 0 && ' ' == code_line.data[0])
+    {
+        code_line = zstr_sub(code_line, 1, code_line.len - 1);
+    }
+    if (MODE_TEXT != st->mode)
+    {
+        if (!zstr_ends_with(&st->pending, "<code>"))
+        {
+            zstr_push(&st->pending, ' ');
+        }
+        zstr_cat_len(&st->pending, code_line.data, code_line.len);
+    }
+    else
+    {
+        zstr_cat_len(&st->doc, code_line.data, code_line.len);
+        zstr_push(&st->doc, '\n');
+    }
+}
+
+void on_include(DocState *st, const DocLine *l)
+{
+    char path[4096];
+    DocInput inc;
+    if (l->arg.len < sizeof(path))
+    {
+        memcpy(path, l->arg.data, l->arg.len);
+        path[l->arg.len] = '\0';
+        char hash[17] = "-";
+        if (doc_input_open(&inc, path))
+        {
+            zstr_cat_len(&st->doc, inc.data, inc.len);
+            doc_hash_hex(inc.data, inc.len, hash);
+            doc_input_close(&inc);
+        }
+        zstr_fmt(&st->deps, "%s %s\n", hash, path);
+    }
+    zstr_push(&st->doc, '\n');
+}
+
+void on_raw(DocState *st, const DocLine *l)
+{
+    zstr_cat_len(&st->doc, l->raw.data, l->raw.len);
+    zstr_push(&st->doc, '\n');
+}
+
+void on_alert(DocState *st, const char *label, zstr_view msg)
+{
+    if (MODE_TEXT != st->mode)
+    {
+        pending_break(st);
+        zstr_fmt(&st->pending, "**%s**: %.*s", label, ZSV_ARG(msg));
+    }
+    else
+    {
+        zstr_fmt(&st->doc, "> **%s**: %.*s\n", label, ZSV_ARG(msg));
+    }
+}
+
+void on_warn(DocState *st, const DocLine *l)
+{
+    on_alert(st, "Warning", l->arg);
+}
+
+void on_note(DocState *st, const DocLine *l)
+{
+    on_alert(st, "Note", l->arg);
+}
+
+void on_deprecated(DocState *st, const DocLine *l)
+{
+    (void)l;
+    pending_break(st);
+    zstr_cat(&st->pending, "**Deprecated**");
+    st->deprecated = true;
+}
+
+void on_bug(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->issues, "* [BUG] %.*s\n", ZSV_ARG(l->arg));
+}
+
+void on_todo(DocState *st, const DocLine *l)
+{
+    zstr_fmt(&st->issues, "* [TODO] %.*s\n", ZSV_ARG(l->arg));
+}
+
+typedef void (*DocHandler)(DocState *st, const DocLine *l);
+
+typedef struct {
+    const char *name;           // Without the '@'.
+    DocHandler handle;
+} DocDirectiveInfo;
+
+// Every directive zdoc_gen understands (see SYNTAX_REFERENCE.md).
+const DocDirectiveInfo DOC_DIRECTIVES[DIR_COUNT] = {
+    [DIR_TEXT]       = { "",           on_text },
+    [DIR_TOC]        = { "toc",        on_toc },
+    [DIR_SECTION]    = { "section",    on_section },
+    [DIR_SUBSECTION] = { "subsection", on_subsection },
+    [DIR_GROUP]      = { "group",      on_group },
+    [DIR_ENDGROUP]   = { "endgroup",   on_endgroup },
+    [DIR_SEPARATOR]  = { "separator",  on_separator },
+    [DIR_STRUCT]     = { "struct",     on_struct },
+    [DIR_ENUM]       = { "enum",       on_enum },
+    [DIR_TABLE]      = { "table",      on_table },
+    [DIR_COLUMNS]    = { "columns",    on_columns },
+    [DIR_ROW]        = { "row",        on_row },
+    [DIR_PARAM]      = { "param",      on_param },
+    [DIR_RETURN]     = { "return",     on_return },
+    [DIR_PRIVATE]    = { "private",    on_private },
+    [DIR_SKIP]       = { "skip",       on_skip },
+    [DIR_EXAMPLE]    = { "example",    on_example },
+    [DIR_ENDEXAMPLE] = { "endexample", on_endexample },
+    [DIR_INCLUDE]    = { "include",    on_include },
+    [DIR_RAW]        = { "raw",        on_raw },
+    [DIR_WARN]       = { "warn",       on_warn },
+    [DIR_NOTE]       = { "note",       on_note },
+    [DIR_DEPRECATED] = { "deprecated", on_deprecated },
+    [DIR_BUG]        = { "bug",        on_bug },
+    [DIR_TODO]       = { "todo",       on_todo },
+    [DIR_RETURNS]    = { "returns",    on_return },
+    [DIR_WARNING]    = { "warning",    on_warn },
+};
+
+/* * Perfect hash of the directive names: (len + c[0] + 6 * c[1] + 27 * c[len - 1]) & 63
+ * is distinct for every name above. Adding a directive means re-checking
+ * that and filling its slot.
+ */
+#define DOC_HASH(p, n) (((n) + (unsigned char)(p)[0] + 6u * (unsigned char)(p)[1] + 27u * (unsigned char)(p)[(n) - 1]) & 63u)
+
+const unsigned char DOC_DIRECTIVE_SLOTS[64] = {
+    [0]  = DIR_BUG,        [2]  = DIR_TOC,        [7]  = DIR_TODO,       [8]  = DIR_RAW,
+    [9]  = DIR_SKIP,       [10] = DIR_PRIVATE,    [17] = DIR_ENDGROUP,   [21] = DIR_SUBSECTION,
+    [24] = DIR_DEPRECATED, [27] = DIR_WARN,       [28] = DIR_ROW,        [32] = DIR_SEPARATOR,
+    [33] = DIR_WARNING,    [35] = DIR_EXAMPLE,    [37] = DIR_COLUMNS,    [38] = DIR_TABLE,
+    [40] = DIR_GROUP,      [42] = DIR_ENDEXAMPLE, [43] = DIR_INCLUDE,    [45] = DIR_STRUCT,
+    [48] = DIR_RETURN,     [50] = DIR_SECTION,    [51] = DIR_NOTE,       [56] = DIR_RETURNS,
+    [58] = DIR_PARAM,      [60] = DIR_ENUM,
+};
+
+/* * Tokenises one comment line: `@word rest` becomes the directive and its
+ * argument, anything else (including unknown `@words`) is DIR_TEXT. One
+ * hash and one compare, however many directives exist.
+ */
+DocDirective lex_doc_line(zstr_view content, DocLine *out)
+{
+    out->content = content;
+    out->arg = content;
+    out->raw = content;
+    if (content.len < 3 || '@' != content.data[0])
+    {
+        return DIR_TEXT;
+    }
+    const char *word = content.data + 1;
+    size_t n = 0;
+    while (n + 1 < content.len && islower((unsigned char)word[n]))
+    {
+        n++;
+    }
+    if (n < 2)
+    {
+        return DIR_TEXT;
+    }
+    DocDirective d = (DocDirective)DOC_DIRECTIVE_SLOTS[DOC_HASH(word, n)];
+    const char *name = DOC_DIRECTIVES[d].name;
+    if (DIR_TEXT == d || strlen(name) != n || 0 != memcmp(name, word, n))
+    {
+        return DIR_TEXT;
+    }
+    out->raw = zstr_sub(content, n + 1, content.len - n - 1);
+    out->arg = zstr_view_trim(out->raw);
+    return d;
+}
+
+// Pipeline.
+
+// Parses one header into `st`. Returns false if it cannot be read.
+bool doc_parse(const char *input_path, DocState *st)
+{
+    if (!zfile_exists(input_path)) 
+    {
+        return false;
+    }
+    DocInput input;
+    if (!doc_input_open(&input, input_path))
+    {
+        return false;
+    }
+    doc_hash_hex(input.data, input.len, st->hash);
+    const char *cursor = input.data;
+    const char *input_end = input.data + input.len;
+    zstr_view raw_line;
+
+    while (doc_next_line(&cursor, input_end, &raw_line)) 
+    {
+        zstr_view line = zstr_view_trim(raw_line);
+        if (0 == line.len && !st->in_block_comment) 
+        {
+            continue;
+        }
+
+        zstr_view content = {NULL, 0};
+        zstr_view raw_content = {NULL, 0};
+        bool is_doc_line = false;
+
+        if (!st->in_block_comment && zstr_view_starts_with(line, "///")) 
+        {
+            raw_content = zstr_sub(line, 3, line.len - 3);
+            content = zstr_view_trim(raw_content);
+            is_doc_line = true;
+        } 
+        else if (!st->in_block_comment && zstr_view_starts_with(line, "/**")) 
+        {
+            st->in_block_comment = true;
+            size_t offset = (line.len > 2 && '*' == line.data[2]) ? 3 : 2;
+            content = zstr_view_trim(zstr_sub(line, offset, line.len - offset));
+            if (zstr_view_ends_with(content, "*/")) 
+            {
+                content.len -= 2; 
+                content = zstr_view_trim(content); 
+                st->in_block_comment = false;
+            }
+            content = strip_decorative_star(content);
+            is_doc_line = true;
+        } 
+        else if (st->in_block_comment) 
+        {
+            content = line;
+            if (zstr_view_ends_with(content, "*/")) 
+            {
+                content.len -= 2; 
+                st->in_block_comment = false;
+            }
+            content = strip_decorative_star(content);
+            is_doc_line = true;
+        }
+
+        if (is_doc_line) 
+        {
+            DocLine dl;
+            DocDirective d = lex_doc_line(content, &dl);
+            if (st->in_example && DIR_ENDEXAMPLE != d) 
+            {
+                on_example_line(st, raw_content);
+            }
+            else 
+            {
+                DOC_DIRECTIVES[d].handle(st, &dl);
+            }
+            continue;
+        }
+
+        if (MODE_TEXT != st->mode && !st->in_block_comment) 
+        {
+            if (st->skip_next || st->is_private) 
+            { 
+                st->skip_next = false; 
+                st->is_private = false; 
+                clear_pending(st); 
+                continue; 
+            }
+            zstr_split_iter it = zstr_split_init(line, "//");
+            zstr_view code_part = {0};
+            zstr_split_next(&it, &code_part);
+            code_part = zstr_view_trim(code_part);
+            if (!is_code_decl(code_part, st->mode)) 
+            {
+                continue;
+            }
+            // Continuation lines extend the view in place; the input is contiguous.
+            zstr_view full_decl = code_part;
+            while (is_incomplete(full_decl, st->mode)) 
+            {
                 zstr_view next_line_v;
-                if (!zfile_reader_next_line(&reader, &next_line_v)) 
+                if (!doc_next_line(&cursor, input_end, &next_line_v)) 
                 {
                     break;
                 }
+                zstr_split_iter next_it = zstr_split_init(next_line_v, "//");
+                zstr_split_next(&next_it, &next_line_v);
                 next_line_v = zstr_view_trim(next_line_v);
                 if (0 == next_line_v.len) 
                 {
                     continue; 
                 }
-                zstr_push(&full_decl, ' ');
-                zstr_cat_len(&full_decl, next_line_v.data, next_line_v.len);
+                full_decl.len = (size_t)(next_line_v.data + next_line_v.len - full_decl.data);
             }
-            if (zstr_starts_with(&full_decl, "#define") && zstr_is_empty(&pending_desc)) 
+            if (zstr_view_starts_with(full_decl, "#define") && zstr_is_empty(&st->pending)) 
             { 
-                zstr_free(&full_decl); 
                 continue; 
             }
-            if (zstr_is_empty(&pending_desc)) 
+            if (zstr_is_empty(&st->pending)) 
             {
                 zstr_view trailing;
                 if (zstr_split_next(&it, &trailing)) 
@@ -524,80 +1153,1156 @@ int main(int argc, char **argv)
                     {
                         trailing = zstr_view_trim(zstr_sub(trailing, 1, trailing.len - 1));
                     }
-                    zstr_cat_len(&pending_desc, trailing.data, trailing.len);
+                    zstr_cat_len(&st->pending, trailing.data, trailing.len);
+                    zstr_cat_len(&st->summary, trailing.data, trailing.len);
                 }
             }
-            zstr clean_sig = clean_signature(zstr_as_view(&full_decl));
-            zstr_fmt(&doc_content, "| `%s` | %s |\n", zstr_cstr(&clean_sig), zstr_cstr(&pending_desc));
-            zstr_free(&clean_sig); 
-            zstr_free(&full_decl); 
-            zstr_clear(&pending_desc);
+            zstr_cat(&st->doc, "| `");
+            size_t signature_at = zstr_len(&st->doc);
+            append_signature(&st->doc, full_decl);
+            if (st->symbols)
+            {
+                zstr_view signature = zstr_sub(zstr_as_view(&st->doc), signature_at, 
+                                               zstr_len(&st->doc) - signature_at);
+                record_symbol(st, full_decl, signature);
+            }
+            zstr_fmt(&st->doc, "` | %s |\n", zstr_cstr(&st->pending));
+            clear_pending(st);
         }
     }
-    zfile_reader_close(&reader);
+    doc_input_close(&input);
+    return true;
+}
 
-    zstr generated = zstr_init();
-    if (strstr(zstr_data(&doc_content), "@toc")) 
-    {
-        zstr_replace(&doc_content, "@toc", "");
-        zstr_cat(&generated, "## Table of Contents\n");
-        zstr_cat(&generated, zstr_cstr(&toc_content));
-        zstr_cat(&generated, "\n");
-    }
-    zstr_cat(&generated, zstr_cstr(&doc_content));
-    if (zstr_len(&issues_content) > 0) 
+// Output.
+
+/* * Streams a page to a temporary file beside it, then renames it into place.
+ * While the bytes still match the previous output nothing is written: the
+ * temporary file is started at the first difference, so an unchanged page
+ * is never rewritten and peak memory is the parsed document alone.
+ */
+typedef struct {
+    DocInput old;               // Previous output, compared as we go.
+    bool has_old;
+    size_t offset;              // Bytes produced so far.
+    FILE *file;                 // Opened at the first difference.
+    zstr tmp_path;
+    bool failed;
+    z_hash_state hash;          // Of every byte produced.
+} DocWriter;
+
+void doc_writer_open(DocWriter *w, const char *out_path)
+{
+    w->has_old = doc_input_open(&w->old, out_path);
+    w->offset = 0;
+    w->file = NULL;
+    w->tmp_path = zstr_init();
+    zstr_fmt(&w->tmp_path, "%s.tmp", out_path);
+    w->failed = false;
+    z_hash_init(&w->hash, 0);
+}
+
+// Starts the temporary file with the prefix that matched the previous output.
+void doc_writer_start(DocWriter *w)
+{
+    w->file = fopen(zstr_cstr(&w->tmp_path), "wb");
+    if (!w->file || (w->offset > 0 && w->offset != fwrite(w->old.data, 1, w->offset, w->file)))
     {
-        zstr_cat(&generated, "\n## Known Issues\n");
-        zstr_cat(&generated, zstr_cstr(&issues_content));
+        w->failed = true;
     }
+}
 
-    zstr existing = zstr_init();
-    bool loaded = false;
-    if (tpl_path && zfile_exists(tpl_path)) 
-    { 
-        existing = zfile_read_all(tpl_path); 
-        loaded = true; 
-    } 
-    else if (zfile_exists(out_path)) 
-    { 
-        existing = zfile_read_all(out_path); 
-        loaded = true; 
+void doc_writer_put(DocWriter *w, const char *data, size_t len)
+{
+    z_hash_update(&w->hash, data, len);
+    if (!w->file && !w->failed)
+    {
+        if (w->has_old && len <= w->old.len - w->offset && 0 == memcmp(w->old.data + w->offset, data, len))
+        {
+            w->offset += len;
+            return;
+        }
+        doc_writer_start(w);
     }
+    if (w->file && !w->failed && len != fwrite(data, 1, len, w->file))
+    {
+        w->failed = true;
+    }
+    w->offset += len;
+}
+
+void doc_writer_cat(DocWriter *w, const char *s)
+{
+    doc_writer_put(w, s, strlen(s));
+}
+
+/* * Moves the page into place if it changed. Returns false if it could not be
+ * written; `hash` receives the hash of the page either way.
+ */
+bool doc_writer_close(DocWriter *w, const char *out_path, char hash[17])
+{
+    snprintf(hash, 17, "%016llx", (unsigned long long)z_hash_final(&w->hash));
+    // Also changed if the new page is a strict prefix of the old one.
+    bool changed = w->file || w->failed || !w->has_old || w->offset != w->old.len;
+    if (changed && !w->file && !w->failed)
+    {
+        doc_writer_start(w);
+    }
+    if (w->file && 0 != fclose(w->file))
+    {
+        w->failed = true;
+    }
+    // Unmap first: Windows cannot replace a file that is still mapped.
+    if (w->has_old)
+    {
+        doc_input_close(&w->old);
+    }
+    if (changed && !w->failed)
+    {
+#if defined(_WIN32)
+        w->failed = !MoveFileExA(zstr_cstr(&w->tmp_path), out_path, MOVEFILE_REPLACE_EXISTING);
+#else
+        w->failed = 0 != rename(zstr_cstr(&w->tmp_path), out_path);
+#endif
+    }
+    if (w->failed && w->file)
+    {
+        remove(zstr_cstr(&w->tmp_path));
+    }
+    zstr_free(&w->tmp_path);
+    return !w->failed;
+}
+
+/* * Saves only if the file's bytes differ, so unchanged outputs keep their
+ * mtime. Returns false, after reporting it, if the file could not be written.
+ */
+bool doc_save_if_changed(const char *path, const char *data, size_t len)
+{
+    DocWriter w;
+    char hash[17];
+    doc_writer_open(&w, path);
+    doc_writer_put(&w, data, len);
+    if (!doc_writer_close(&w, path, hash))
+    {
+        fprintf(stderr, "zdoc_gen: cannot write '%s'\n", path);
+        return false;
+    }
+    return true;
+}
+
+/* * The generated block. The TOC is a deferred segment: it is collected
+ * while parsing and emitted ahead of the body only once the header is done.
+ */
+void doc_emit_generated(DocWriter *w, const DocState *st)
+{
+    if (st->want_toc) 
+    {
+        doc_writer_cat(w, "## Table of Contents\n");
+        doc_writer_put(w, zstr_cstr(&st->toc), zstr_len(&st->toc));
+        doc_writer_cat(w, "\n");
+    }
+    doc_writer_put(w, zstr_cstr(&st->doc), zstr_len(&st->doc));
+    if (zstr_len(&st->issues) > 0) 
+    {
+        doc_writer_cat(w, "\n## Known Issues\n");
+        doc_writer_put(w, zstr_cstr(&st->issues), zstr_len(&st->issues));
+    }
+}
+
+/* * Writes the template head, the generated block and the template tail
+ * (the previous output stands in for a missing template). Nothing is
+ * assembled in memory: both files are mapped and streamed from.
+ * `out_hash` receives the hash of the page.
+ */
+bool doc_write(const char *out_path, const char *tpl_path, const DocState *st, char out_hash[17])
+{
+    DocWriter w;
+    doc_writer_open(&w, out_path);
+    DocInput tpl;
+    bool has_tpl = tpl_path && doc_input_open(&tpl, tpl_path);
+    const DocInput *base = has_tpl ? &tpl : (w.has_old ? &w.old : NULL);
+    const char *start_marker = base ? z_memmem(base->data, base->len, MARKER_START, strlen(MARKER_START)) : NULL;
+    const char *end_marker   = base ? z_memmem(base->data, base->len, MARKER_END, strlen(MARKER_END)) : NULL;
 
-    zstr final_out = zstr_init();
-    char *start_marker = loaded ? strstr(zstr_data(&existing), MARKER_START) : NULL;
-    char *end_marker   = loaded ? strstr(zstr_data(&existing), MARKER_END) : NULL;
     if (start_marker && end_marker && end_marker > start_marker) 
     {
-        size_t head_len = start_marker - zstr_data(&existing);
-        zstr_cat_len(&final_out, zstr_data(&existing), head_len);
-        zstr_cat(&final_out, "\n"); zstr_cat(&final_out, zstr_cstr(&generated)); zstr_cat(&final_out, "\n");
-        zstr_cat(&final_out, end_marker + strlen(MARKER_END)); 
+        const char *tail = end_marker + strlen(MARKER_END);
+        doc_writer_put(&w, base->data, (size_t)(start_marker - base->data));
+        doc_writer_cat(&w, "\n");
+        doc_emit_generated(&w, st);
+        doc_writer_cat(&w, "\n");
+        doc_writer_put(&w, tail, (size_t)(base->data + base->len - tail));
     } 
-    else if (loaded) 
+    else if (base) 
     {
-        zstr_cat(&final_out, zstr_cstr(&existing));
-        if (!zstr_ends_with(&existing, "\n")) 
+        doc_writer_put(&w, base->data, base->len);
+        if (0 == base->len || '\n' != base->data[base->len - 1]) 
         {
-            zstr_push(&final_out, '\n');
+            doc_writer_cat(&w, "\n");
         }
-        zstr_cat(&final_out, "\n"); 
-        zstr_cat(&final_out, zstr_cstr(&generated)); 
-        zstr_cat(&final_out, "\n");
+        doc_writer_cat(&w, "\n");
+        doc_emit_generated(&w, st);
+        doc_writer_cat(&w, "\n");
     } 
     else 
     {
-        zstr_cat(&final_out, "# API Reference\n\n"); 
-        zstr_cat(&final_out, zstr_cstr(&generated));
+        doc_writer_cat(&w, "# API Reference\n\n");
+        doc_emit_generated(&w, st);
+    }
+
+    if (has_tpl)
+    {
+        doc_input_close(&tpl);
+    }
+    bool ok = doc_writer_close(&w, out_path, out_hash);
+    if (!ok)
+    {
+        fprintf(stderr, "zdoc_gen: cannot write '%s'\n", out_path);
+    }
+    return ok;
+}
+
+// Symbol database.
+
+/* * A binary index of every documented symbol, meant to be mapped and
+ * binary-searched in place. All integers are little-endian uint32:
+ *
+ *   "ZSYM" version count record_size source pool_size
+ *   record[count]       DocSymbol, sorted by name (bytewise), then scope
+ *   pool[pool_size]     NUL-terminated strings; each field is an offset here
+ *
+ * Readers step over records by record_size, so fields can be appended later.
+ */
+#define DOC_SYMDB_VERSION 1u
+#define DOC_SYMDB_HEADER  24u
+#define DOC_SYMDB_FIELDS  8u
+
+typedef struct {
+    const char *name;
+    const char *scope;
+    size_t index;
+} DocSymbolKey;
+
+int doc_cmp_symbols(const void *a, const void *b)
+{
+    const DocSymbolKey *x = (const DocSymbolKey *)a;
+    const DocSymbolKey *y = (const DocSymbolKey *)b;
+    int c = strcmp(x->name, y->name);
+    if (0 == c)
+    {
+        c = strcmp(x->scope, y->scope);
+    }
+    if (0 == c)
+    {
+        c = (x->index > y->index) - (x->index < y->index);
+    }
+    return c;
+}
+
+void doc_put_u32(zstr *out, uint32_t v)
+{
+    char b[4] = {(char)(v & 0xff), (char)((v >> 8) & 0xff), (char)((v >> 16) & 0xff), (char)(v >> 24)};
+    zstr_cat_len(out, b, 4);
+}
+
+uint32_t doc_get_u32(const char *p)
+{
+    const unsigned char *u = (const unsigned char *)p;
+    return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+// Sorts the symbols and writes the database like any other output (only if changed).
+bool doc_write_symbols(const char *path, const char *source, DocSymbols *syms, char hash[17])
+{
+    uint32_t source_at = doc_pool_add(&syms->pool, zstr_view_from(source));
+    const char *pool = zstr_cstr(&syms->pool);
+    DocSymbolKey *keys = (DocSymbolKey *)malloc((syms->count ? syms->count : 1) * sizeof(DocSymbolKey));
+    if (!keys)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < syms->count; i++)
+    {
+        keys[i].name = pool + syms->items[i].name;
+        keys[i].scope = pool + syms->items[i].scope;
+        keys[i].index = i;
+    }
+    qsort(keys, syms->count, sizeof(DocSymbolKey), doc_cmp_symbols);
+
+    // The header and record table are small next to the pool; build them first.
+    zstr table = zstr_init();
+    zstr_cat_len(&table, "ZSYM", 4);
+    doc_put_u32(&table, DOC_SYMDB_VERSION);
+    doc_put_u32(&table, (uint32_t)syms->count);
+    doc_put_u32(&table, DOC_SYMDB_FIELDS * 4);
+    doc_put_u32(&table, source_at);
+    doc_put_u32(&table, (uint32_t)zstr_len(&syms->pool));
+    for (size_t i = 0; i < syms->count; i++)
+    {
+        const DocSymbol *sym = &syms->items[keys[i].index];
+        doc_put_u32(&table, sym->name);
+        doc_put_u32(&table, sym->kind);
+        doc_put_u32(&table, sym->scope);
+        doc_put_u32(&table, sym->signature);
+        doc_put_u32(&table, sym->summary);
+        doc_put_u32(&table, sym->params);
+        doc_put_u32(&table, sym->returns);
+        doc_put_u32(&table, sym->flags);
+    }
+    free(keys);
+
+    DocWriter w;
+    doc_writer_open(&w, path);
+    doc_writer_put(&w, zstr_cstr(&table), zstr_len(&table));
+    doc_writer_put(&w, pool, zstr_len(&syms->pool));
+    zstr_free(&table);
+    bool ok = doc_writer_close(&w, path, hash);
+    if (!ok)
+    {
+        fprintf(stderr, "zdoc_gen: cannot write '%s'\n", path);
+    }
+    return ok;
+}
+
+/* * zdoc_gen --lookup <db> <name>: prints every symbol called `name`, found
+ * by binary search over the mapped record table.
+ */
+int doc_lookup(const char *db_path, const char *name)
+{
+    DocInput db;
+    if (!doc_input_open(&db, db_path))
+    {
+        fprintf(stderr, "zdoc_gen: cannot read '%s'\n", db_path);
+        return 1;
+    }
+    const char *d = db.data;
+    uint32_t count = db.len >= DOC_SYMDB_HEADER ? doc_get_u32(d + 8) : 0;
+    uint32_t stride = db.len >= DOC_SYMDB_HEADER ? doc_get_u32(d + 12) : 0;
+    uint32_t pool_size = db.len >= DOC_SYMDB_HEADER ? doc_get_u32(d + 20) : 0;
+    size_t pool_at = DOC_SYMDB_HEADER + (size_t)count * stride;
+    if (db.len < DOC_SYMDB_HEADER || 0 != memcmp(d, "ZSYM", 4) || DOC_SYMDB_VERSION != doc_get_u32(d + 4) || 
+        stride < DOC_SYMDB_FIELDS * 4 || pool_at + pool_size != db.len || 0 == pool_size || 
+        '\0' != d[db.len - 1])
+    {
+        fprintf(stderr, "zdoc_gen: '%s' is not a symbol database\n", db_path);
+        doc_input_close(&db);
+        return 1;
+    }
+    const char *pool = d + pool_at;
+    const char *records = d + DOC_SYMDB_HEADER;
+
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t at = doc_get_u32(records + mid * stride);
+        if (at < pool_size && strcmp(pool + at, name) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    int status = 1;
+    for (size_t i = lo; i < count; i++)
+    {
+        const char *r = records + i * stride;
+        uint32_t f[DOC_SYMDB_FIELDS];
+        for (size_t k = 0; k < DOC_SYMDB_FIELDS; k++)
+        {
+            f[k] = doc_get_u32(r + 4 * k);
+            if (1 != k && 7 != k && f[k] >= pool_size)
+            {
+                f[k] = 0;
+            }
+        }
+        if (0 != strcmp(pool + f[0], name))
+        {
+            break;
+        }
+        status = 0;
+        printf("%s\n    %s", pool + f[3], f[1] <= SYM_VALUE ? DOC_SYMBOL_KINDS[f[1]] : "?");
+        if (pool[f[2]])
+        {
+            printf(" in %s", pool + f[2]);
+        }
+        printf("%s\n", (f[7] & DOC_SYM_DEPRECATED) ? " (deprecated)" : "");
+        if (pool[f[4]])
+        {
+            printf("    %s\n", pool + f[4]);
+        }
+        zstr_split_iter it = zstr_split_init(zstr_view_from(pool + f[5]), "\n");
+        zstr_view param;
+        while (zstr_split_next(&it, &param))
+        {
+            if (param.len > 0)
+            {
+                printf("    @param %.*s\n", ZSV_ARG(param));
+            }
+        }
+        if (pool[f[6]])
+        {
+            printf("    @return %s\n", pool + f[6]);
+        }
+    }
+    doc_input_close(&db);
+    return status;
+}
+
+// Batch mode.
+
+typedef struct {
+    zstr input;
+    zstr output;
+    zstr tpl;                   // Empty: merge into the previous output.
+    zstr stamp;                 // Empty: always regenerate.
+    zstr depfile;               // Empty: no depfile.
+    zstr symbols;               // Empty: no symbol database.
+    zstr toc;                   // The header's TOC, kept for the index.
+    bool ok;
+} DocJob;
+
+typedef struct {
+    DocJob *items;
+    size_t count;
+    size_t cap;
+} DocJobList;
+
+bool doc_job_add(DocJobList *list, zstr_view input, zstr_view output, zstr_view tpl)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 16;
+        DocJob *grown = (DocJob *)realloc(list->items, cap * sizeof(DocJob));
+        if (!grown)
+        {
+            return false;
+        }
+        list->items = grown;
+        list->cap = cap;
+    }
+    DocJob *job = &list->items[list->count++];
+    job->input = zstr_init();
+    job->output = zstr_init();
+    job->tpl = zstr_init();
+    job->stamp = zstr_init();
+    job->depfile = zstr_init();
+    job->symbols = zstr_init();
+    job->toc = zstr_init();
+    job->ok = false;
+    zstr_cat_len(&job->input, input.data, input.len);
+    zstr_cat_len(&job->output, output.data, output.len);
+    zstr_cat_len(&job->tpl, tpl.data, tpl.len);
+    return true;
+}
+
+void doc_jobs_free(DocJobList *list)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        zstr_free(&list->items[i].input);
+        zstr_free(&list->items[i].output);
+        zstr_free(&list->items[i].tpl);
+        zstr_free(&list->items[i].stamp);
+        zstr_free(&list->items[i].depfile);
+        zstr_free(&list->items[i].symbols);
+        zstr_free(&list->items[i].toc);
+    }
+    free(list->items);
+}
+
+// Length of the directory part of `path`, including the separator.
+size_t doc_dir_len(zstr_view path)
+{
+    size_t n = path.len;
+    while (n > 0 && '/' != path.data[n - 1] && '\\' != path.data[n - 1])
+    {
+        n--;
+    }
+    return n;
+}
+
+bool doc_is_dir(const char *path)
+{
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    return INVALID_FILE_ATTRIBUTES != attr && (attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return 0 == stat(path, &st) && S_ISDIR(st.st_mode);
+#endif
+}
+
+int doc_cmp_names(const void *a, const void *b)
+{
+    return strcmp(zstr_cstr((const zstr *)a), zstr_cstr((const zstr *)b));
+}
+
+/* * One job per `*.h` in `dir`, in name order, writing `<out_dir>/<stem>.md`.
+ * Not recursive: nested libraries get a directory run or a manifest of their own.
+ */
+bool doc_jobs_from_dir(DocJobList *list, const char *dir, const char *out_dir)
+{
+    zstr *names = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+#if defined(_WIN32)
+    zstr pattern = zstr_init();
+    zstr_fmt(&pattern, "%s\\*.h", dir);
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA(zstr_cstr(&pattern), &found);
+    zstr_free(&pattern);
+    if (INVALID_HANDLE_VALUE == h)
+    {
+        return false;
+    }
+    do
+    {
+        const char *name = found.cFileName;
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            continue;
+        }
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        return false;
+    }
+    struct dirent *ent;
+    while (NULL != (ent = readdir(d)))
+    {
+        const char *name = ent->d_name;
+        if (!zstr_view_ends_with(zstr_view_from(name), ".h"))
+        {
+            continue;
+        }
+#endif
+        if (count == cap)
+        {
+            cap = cap ? cap * 2 : 16;
+            names = (zstr *)realloc(names, cap * sizeof(zstr));
+        }
+        names[count] = zstr_init();
+        zstr_cat(&names[count++], name);
+#if defined(_WIN32)
+    } while (FindNextFileA(h, &found));
+    FindClose(h);
+#else
+    }
+    closedir(d);
+#endif
+    if (count > 1)
+    {
+        qsort(names, count, sizeof(zstr), doc_cmp_names);
+    }
+
+    zstr_view in_dir = zstr_view_trim(zstr_view_from(dir));
+    zstr_view to_dir = zstr_view_trim(zstr_view_from(out_dir ? out_dir : dir));
+    bool ok = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        zstr input = zstr_init();
+        zstr output = zstr_init();
+        zstr_view name = zstr_as_view(&names[i]);
+        zstr_fmt(&input, "%.*s/%.*s", ZSV_ARG(in_dir), ZSV_ARG(name));
+        zstr_fmt(&output, "%.*s/%.*s.md", ZSV_ARG(to_dir), (int)(name.len - 2), name.data);
+        zstr_view none = {NULL, 0};
+        ok = doc_job_add(list, zstr_as_view(&input), zstr_as_view(&output), none) && ok;
+        zstr_free(&input);
+        zstr_free(&output);
+        zstr_free(&names[i]);
+    }
+    free(names);
+    return ok;
+}
+
+/* * One job per manifest line: `header [output] [template]`, separated by
+ * whitespace. Blank lines and `#` comments are skipped; the output defaults
+ * to the header with a `.md` extension. Paths are as on the command line.
+ */
+bool doc_jobs_from_manifest(DocJobList *list, const char *path)
+{
+    DocInput in;
+    if (!doc_input_open(&in, path))
+    {
+        return false;
+    }
+    const char *cursor = in.data;
+    const char *end = in.data + in.len;
+    zstr_view line;
+    bool ok = true;
+    while (doc_next_line(&cursor, end, &line))
+    {
+        line = zstr_view_trim(line);
+        if (0 == line.len || '#' == line.data[0])
+        {
+            continue;
+        }
+        zstr_view fields[3] = {{NULL, 0}, {NULL, 0}, {NULL, 0}};
+        size_t n = 0;
+        size_t i = 0;
+        while (i < line.len && n < 3)
+        {
+            while (i < line.len && isspace((unsigned char)line.data[i]))
+            {
+                i++;
+            }
+            size_t start = i;
+            while (i < line.len && !isspace((unsigned char)line.data[i]))
+            {
+                i++;
+            }
+            if (i > start)
+            {
+                fields[n].data = line.data + start;
+                fields[n++].len = i - start;
+            }
+        }
+        zstr output = zstr_init();
+        if (fields[1].len > 0)
+        {
+            zstr_cat_len(&output, fields[1].data, fields[1].len);
+        }
+        else
+        {
+            size_t stem = fields[0].len;
+            if (zstr_view_ends_with(fields[0], ".h"))
+            {
+                stem -= 2;
+            }
+            zstr_fmt(&output, "%.*s.md", (int)stem, fields[0].data);
+        }
+        ok = doc_job_add(list, fields[0], zstr_as_view(&output), fields[2]) && ok;
+        zstr_free(&output);
+    }
+    doc_input_close(&in);
+    return ok;
+}
+
+// Incremental builds.
+
+#define DOC_STAMP_VERSION "zdoc-stamp 1"   // Bump whenever output changes for the same input.
+
+/* * A stamp records the hash and path of everything the output was built
+ * from, the output's own hash, and the TOC (so a batch index can be written
+ * without reparsing):
+ *
+ *   zdoc-stamp 1
+ *   header <hash> <path>
+ *   template <hash> <path>
+ *   include <hash> <path>
+ *   output <hash> <path>
+ *   symbols <hash> <path>
+ *   toc <entry>
+ *
+ * Unreadable files hash as "-", so creating a missing @include is a change too.
+ */
+zstr doc_stamp_render(const DocJob *job, const char *header_hash, const char *out_hash, 
+                      const char *symbols_hash, const zstr *deps, const zstr *toc)
+{
+    zstr s = zstr_init();
+    zstr_fmt(&s, "%s\nheader %s %s\n", DOC_STAMP_VERSION, header_hash, zstr_cstr(&job->input));
+    if (!zstr_is_empty(&job->tpl))
+    {
+        char hash[17];
+        doc_hash_file(zstr_cstr(&job->tpl), hash);
+        zstr_fmt(&s, "template %s %s\n", hash, zstr_cstr(&job->tpl));
+    }
+    zstr_split_iter it = zstr_split_init(zstr_as_view(deps), "\n");
+    zstr_view dep;
+    while (zstr_split_next(&it, &dep))
+    {
+        if (dep.len > 0)
+        {
+            zstr_fmt(&s, "include %.*s\n", ZSV_ARG(dep));
+        }
+    }
+    zstr_fmt(&s, "output %s %s\n", out_hash, zstr_cstr(&job->output));
+    if (!zstr_is_empty(&job->symbols))
+    {
+        zstr_fmt(&s, "symbols %s %s\n", symbols_hash, zstr_cstr(&job->symbols));
+    }
+    it = zstr_split_init(zstr_as_view(toc), "\n");
+    zstr_view entry;
+    while (zstr_split_next(&it, &entry))
+    {
+        if (entry.len > 0)
+        {
+            zstr_fmt(&s, "toc %.*s\n", ZSV_ARG(entry));
+        }
+    }
+    return s;
+}
+
+// Splits "<word> <rest>" at the first space.
+bool doc_split_word(zstr_view line, zstr_view *word, zstr_view *rest)
+{
+    const char *space = line.len > 0 ? (const char *)memchr(line.data, ' ', line.len) : NULL;
+    if (!space)
+    {
+        return false;
+    }
+    word->data = line.data;
+    word->len = (size_t)(space - line.data);
+    rest->data = space + 1;
+    rest->len = line.len - word->len - 1;
+    return true;
+}
+
+// True if `recorded` ("<hash> <path>") names `path` and the file still hashes the same.
+bool doc_stamp_entry_fresh(zstr_view recorded, const zstr *path)
+{
+    zstr_view hash;
+    zstr_view rest;
+    if (!doc_split_word(recorded, &hash, &rest))
+    {
+        return false;
+    }
+    zstr name = zstr_init();
+    zstr_cat_len(&name, rest.data, rest.len);
+    bool fresh = !path || zstr_view_eq(rest, zstr_as_view(path));
+    if (fresh)
+    {
+        char now[17];
+        doc_hash_file(zstr_cstr(&name), now);
+        fresh = zstr_view_eq(hash, zstr_view_from(now));
+    }
+    zstr_free(&name);
+    return fresh;
+}
+
+/* * True if the job's stamp matches its paths and every recorded file is
+ * unchanged. On success `deps` and `toc` are filled from the stamp.
+ */
+bool doc_stamp_fresh(const DocJob *job, zstr *deps, zstr *toc)
+{
+    DocInput in;
+    if (!doc_input_open(&in, zstr_cstr(&job->stamp)))
+    {
+        return false;
+    }
+    const char *cursor = in.data;
+    const char *end = in.data + in.len;
+    zstr_view line;
+    bool fresh = doc_next_line(&cursor, end, &line) && zstr_view_eq(line, zstr_view_from(DOC_STAMP_VERSION));
+    bool seen_header = false;
+    bool seen_tpl = false;
+    bool seen_output = false;
+    bool seen_symbols = false;
+    while (fresh && doc_next_line(&cursor, end, &line))
+    {
+        zstr_view role;
+        zstr_view rest;
+        if (!doc_split_word(line, &role, &rest))
+        {
+            fresh = 0 == line.len;
+            continue;
+        }
+        if (zstr_view_eq(role, zstr_view_from("toc")))
+        {
+            zstr_cat_len(toc, rest.data, rest.len);
+            zstr_push(toc, '\n');
+        }
+        else if (zstr_view_eq(role, zstr_view_from("include")))
+        {
+            fresh = doc_stamp_entry_fresh(rest, NULL);
+            zstr_cat_len(deps, rest.data, rest.len);
+            zstr_push(deps, '\n');
+        }
+        else if (zstr_view_eq(role, zstr_view_from("header")))
+        {
+            fresh = doc_stamp_entry_fresh(rest, &job->input);
+            seen_header = true;
+        }
+        else if (zstr_view_eq(role, zstr_view_from("template")))
+        {
+            fresh = doc_stamp_entry_fresh(rest, &job->tpl);
+            seen_tpl = true;
+        }
+        else if (zstr_view_eq(role, zstr_view_from("output")))
+        {
+            fresh = doc_stamp_entry_fresh(rest, &job->output);
+            seen_output = true;
+        }
+        else if (zstr_view_eq(role, zstr_view_from("symbols")))
+        {
+            fresh = doc_stamp_entry_fresh(rest, &job->symbols);
+            seen_symbols = true;
+        }
+        else
+        {
+            fresh = false;
+        }
+    }
+    doc_input_close(&in);
+    return fresh && seen_header && seen_output && seen_tpl == !zstr_is_empty(&job->tpl) && 
+           seen_symbols == !zstr_is_empty(&job->symbols);
+}
+
+// Appends `path` escaped for Make and Ninja depfiles.
+void doc_dep_path(zstr *out, zstr_view path)
+{
+    zstr_push(out, ' ');
+    for (size_t i = 0; i < path.len; i++)
+    {
+        char c = path.data[i];
+        if (' ' == c || '#' == c)
+        {
+            zstr_push(out, '\\');
+        }
+        else if ('$' == c)
+        {
+            zstr_push(out, '$');
+        }
+        zstr_push(out, c);
+    }
+}
+
+// `output: header [template] includes...`, one rule Make and Ninja both read.
+bool doc_write_depfile(const DocJob *job, const zstr *deps)
+{
+    zstr out = zstr_init();
+    doc_dep_path(&out, zstr_as_view(&job->output));
+    zstr_push(&out, ':');
+    doc_dep_path(&out, zstr_as_view(&job->input));
+    if (!zstr_is_empty(&job->tpl))
+    {
+        doc_dep_path(&out, zstr_as_view(&job->tpl));
+    }
+    zstr_split_iter it = zstr_split_init(zstr_as_view(deps), "\n");
+    zstr_view dep;
+    while (zstr_split_next(&it, &dep))
+    {
+        zstr_view hash;
+        zstr_view path;
+        if (doc_split_word(dep, &hash, &path))
+        {
+            doc_dep_path(&out, path);
+        }
+    }
+    zstr_push(&out, '\n');
+    // Drop the separator doc_dep_path put before the target.
+    bool ok = doc_save_if_changed(zstr_cstr(&job->depfile), zstr_cstr(&out) + 1, zstr_len(&out) - 1);
+    zstr_free(&out);
+    return ok;
+}
+
+/* * Builds one page. With a stamp, an up-to-date job only refreshes its
+ * depfile; otherwise the header is parsed and every file is saved only if
+ * its bytes changed, the stamp last so an interrupted or failed run is
+ * redone. A stamp that cannot be written is removed for the same reason.
+ */
+void doc_run(DocJob *job)
+{
+    if (!zstr_is_empty(&job->stamp))
+    {
+        zstr deps = zstr_init();
+        zstr toc = zstr_init();
+        if (doc_stamp_fresh(job, &deps, &toc))
+        {
+            job->ok = zstr_is_empty(&job->depfile) || doc_write_depfile(job, &deps);
+            zstr_free(&job->toc);
+            job->toc = toc;
+            zstr_free(&deps);
+            return;
+        }
+        zstr_free(&deps);
+        zstr_free(&toc);
+    }
+
+    DocState st = doc_state_init();
+    DocSymbols syms = {NULL, 0, 0, zstr_init()};
+    zstr_push(&syms.pool, '\0');
+    if (!zstr_is_empty(&job->symbols))
+    {
+        st.symbols = &syms;
+    }
+    char out_hash[17];
+    char symbols_hash[17] = "-";
+    job->ok = false;
+    if (!doc_parse(zstr_cstr(&job->input), &st))
+    {
+        fprintf(stderr, "zdoc_gen: cannot read '%s'\n", zstr_cstr(&job->input));
+    }
+    else
+    {
+        const char *tpl = zstr_is_empty(&job->tpl) ? NULL : zstr_cstr(&job->tpl);
+        job->ok = doc_write(zstr_cstr(&job->output), tpl, &st, out_hash);
+        if (job->ok && st.symbols)
+        {
+            job->ok = doc_write_symbols(zstr_cstr(&job->symbols), zstr_cstr(&job->input), &syms, symbols_hash);
+        }
+    }
+    if (job->ok && !zstr_is_empty(&job->depfile))
+    {
+        job->ok = doc_write_depfile(job, &st.deps);
+    }
+    if (job->ok && !zstr_is_empty(&job->stamp))
+    {
+        zstr stamp = doc_stamp_render(job, st.hash, out_hash, symbols_hash, &st.deps, &st.toc);
+        job->ok = doc_save_if_changed(zstr_cstr(&job->stamp), zstr_cstr(&stamp), zstr_len(&stamp));
+        zstr_free(&stamp);
+    }
+    if (!job->ok && !zstr_is_empty(&job->stamp))
+    {
+        remove(zstr_cstr(&job->stamp));
+    }
+    if (job->ok)
+    {
+        zstr_free(&job->toc);
+        job->toc = st.toc;
+        st.toc = zstr_init();
+    }
+    doc_state_free(&st);
+    free(syms.items);
+    zstr_free(&syms.pool);
+}
+
+// Jobs share nothing but read-only input, so any split of the range is safe.
+void doc_run_range(void *ctx, size_t begin, size_t end)
+{
+    DocJobList *list = (DocJobList *)ctx;
+    for (size_t i = begin; i < end; i++)
+    {
+        doc_run(&list->items[i]);
+    }
+}
+
+/* * One section per header, linking its page and then its TOC entries with
+ * the `#anchor` links make_anchor produced, rebased onto the page. Pages
+ * under the index's directory are linked relative to it.
+ */
+bool doc_write_index(const char *index_path, const DocJobList *list)
+{
+    zstr_view index_v = zstr_view_from(index_path);
+    size_t index_dir = doc_dir_len(index_v);
+    zstr out = zstr_init();
+    zstr_cat(&out, "# API Index\n");
+    for (size_t i = 0; i < list->count; i++)
+    {
+        const DocJob *job = &list->items[i];
+        if (!job->ok)
+        {
+            continue;
+        }
+        zstr_view input = zstr_as_view(&job->input);
+        zstr_view page = zstr_as_view(&job->output);
+        if (index_dir > 0 && page.len > index_dir && 0 == memcmp(page.data, index_path, index_dir))
+        {
+            page = zstr_sub(page, index_dir, page.len - index_dir);
+        }
+        size_t name = doc_dir_len(input);
+        zstr_fmt(&out, "\n## [%.*s](%.*s)\n\n", (int)(input.len - name), input.data + name, 
+                 ZSV_ARG(page));
+
+        zstr_split_iter it = zstr_split_init(zstr_as_view(&job->toc), "\n");
+        zstr_view entry;
+        while (zstr_split_next(&it, &entry))
+        {
+            zstr_split_iter link = zstr_split_init(entry, "](#");
+            zstr_view title;
+            zstr_view anchor;
+            zstr_split_next(&link, &title);
+            if (!zstr_split_next(&link, &anchor))
+            {
+                continue;
+            }
+            zstr_fmt(&out, "%.*s](%.*s#%.*s\n", ZSV_ARG(title), ZSV_ARG(page), ZSV_ARG(anchor));
+        }
+    }
+    bool ok = doc_save_if_changed(index_path, zstr_cstr(&out), zstr_len(&out));
+    zstr_free(&out);
+    return ok;
+}
+
+/* * zdoc_gen --batch <dir|manifest> [--out DIR] [--index FILE] [--jobs N]
+ *                 [--incremental] [--depfiles] [--symbols]
+ *
+ * --incremental keeps `<output>.stamp` beside each page, --depfiles writes
+ * `<output>.d` and --symbols `<output>.zsym`.
+ * Headers are parsed and written concurrently on the ztask scheduler; the
+ * index is written last, in job order, so its contents never depend on timing.
+ */
+int doc_batch(int argc, char **argv)
+{
+    const char *source = NULL;
+    const char *out_dir = NULL;
+    const char *index_path = NULL;
+    size_t jobs = 0;
+    bool incremental = false;
+    bool depfiles = false;
+    bool symbols = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "--incremental"))
+        {
+            incremental = true;
+        }
+        else if (0 == strcmp(argv[i], "--depfiles"))
+        {
+            depfiles = true;
+        }
+        else if (0 == strcmp(argv[i], "--symbols"))
+        {
+            symbols = true;
+        }
+        else if (0 == strcmp(argv[i], "--out") && i + 1 < argc)
+        {
+            out_dir = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--index") && i + 1 < argc)
+        {
+            index_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--jobs") && i + 1 < argc)
+        {
+            jobs = (size_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (!source)
+        {
+            source = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "zdoc_gen: unexpected argument '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!source)
+    {
+        fprintf(stderr, "zdoc_gen: --batch needs a directory or a manifest\n");
+        return 1;
+    }
+
+    DocJobList list = {NULL, 0, 0};
+    bool listed = doc_is_dir(source) ? doc_jobs_from_dir(&list, source, out_dir) 
+                                     : doc_jobs_from_manifest(&list, source);
+    if (!listed)
+    {
+        fprintf(stderr, "zdoc_gen: cannot read '%s'\n", source);
+        doc_jobs_free(&list);
+        return 1;
+    }
+    for (size_t i = 0; i < list.count; i++)
+    {
+        DocJob *job = &list.items[i];
+        if (incremental)
+        {
+            zstr_fmt(&job->stamp, "%s.stamp", zstr_cstr(&job->output));
+        }
+        if (depfiles)
+        {
+            zstr_fmt(&job->depfile, "%s.d", zstr_cstr(&job->output));
+        }
+        if (symbols)
+        {
+            zstr_fmt(&job->symbols, "%s.zsym", zstr_cstr(&job->output));
+        }
     }
 
-    zfile_save_atomic(out_path, zstr_cstr(&final_out), zstr_len(&final_out));
-    zstr_free(&existing); zstr_free(&final_out); 
-    zstr_free(&doc_content);
-    zstr_free(&toc_content); 
-    zstr_free(&issues_content); 
-    zstr_free(&pending_desc);
-    zstr_free(&current_columns); 
-    zstr_free(&generated);
-    return 0;
+    if (1 == jobs || list.count < 2)
+    {
+        doc_run_range(&list, 0, list.count);
+    }
+    else
+    {
+        if (jobs > 1)
+        {
+            z_sched_start(jobs - 1);  // The calling thread works too.
+        }
+        z_parallel_for(0, list.count, 1, doc_run_range, &list);
+        z_sched_stop();
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < list.count; i++)
+    {
+        if (!list.items[i].ok)
+        {
+            status = 1;
+        }
+    }
+    if (index_path && !doc_write_index(index_path, &list))
+    {
+        status = 1;
+    }
+    doc_jobs_free(&list);
+    return status;
+}
+
+/* * zdoc_gen [--incremental] [--depfile FILE] [--symbols FILE] <header> [output] [template]
+ *
+ * --incremental keeps `<output>.stamp` and skips the run when nothing it
+ * records has changed. --symbols writes the symbol database in the same pass.
+ */
+int main(int argc, char **argv) 
+{
+    if (argc >= 2 && 0 == strcmp(argv[1], "--batch"))
+    {
+        return doc_batch(argc, argv);
+    }
+    if (4 == argc && 0 == strcmp(argv[1], "--lookup"))
+    {
+        return doc_lookup(argv[2], argv[3]);
+    }
+
+    const char *args[3] = {NULL, DEFAULT_OUT, NULL};
+    int count = 0;
+    bool incremental = false;
+    const char *depfile = NULL;
+    const char *symbols = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "--incremental"))
+        {
+            incremental = true;
+        }
+        else if (0 == strcmp(argv[i], "--depfile") && i + 1 < argc)
+        {
+            depfile = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--symbols") && i + 1 < argc)
+        {
+            symbols = argv[++i];
+        }
+        else if (count < 3)
+        {
+            args[count++] = argv[i];
+        }
+    }
+    if (0 == count) 
+    {
+        printf("Usage: zdoc_gen [--incremental] [--depfile FILE] [--symbols FILE] <header> [output] [template]\n");
+        printf("       zdoc_gen --batch <dir|manifest> [--out DIR] [--index FILE] [--jobs N]\n");
+        printf("                [--incremental] [--depfiles] [--symbols]\n");
+        printf("       zdoc_gen --lookup <symbols> <name>\n");
+        return 1;
+    }
+
+    DocJobList list = {NULL, 0, 0};
+    zstr_view none = {NULL, 0};
+    doc_job_add(&list, zstr_view_from(args[0]), zstr_view_from(args[1]), 
+                args[2] ? zstr_view_from(args[2]) : none);
+    DocJob *job = &list.items[0];
+    if (incremental)
+    {
+        zstr_fmt(&job->stamp, "%s.stamp", args[1]);
+    }
+    if (depfile)
+    {
+        zstr_cat(&job->depfile, depfile);
+    }
+    if (symbols)
+    {
+        zstr_cat(&job->symbols, symbols);
+    }
+    doc_run(job);
+    int status = job->ok ? 0 : 1;
+    doc_jobs_free(&list);
+    return status;
 }
@@ -0,0 +1,331 @@
+/*
+ * zhash.h — Seeded hash functions for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Shared hashing for map-style containers so every z-lib hashes the same way:
+ *   - z_hash_bytes: wyhash-class bulk hash (48-byte stripes, 64x64->128 mixing).
+ *   - z_hash_u32 / z_hash_u64 / z_hash_ptr: one-multiply integer mixers.
+ *   - z_hash_state: streaming variant for multi-part keys. Feeding the same
+ *     bytes in any split gives exactly the z_hash_bytes result.
+ *
+ * z_hash_seed() returns a per-process random seed (to resist hash flooding);
+ * containers usually fetch it once at init. Define Z_HASH_FIXED_SEED to get
+ * reproducible hashes, e.g. in tests.
+ *
+ * Results are identical across platforms (input is read little-endian).
+ *
+ * The hashing functions are header-only. Define ZHASH_IMPLEMENTATION in
+ * exactly one translation unit for z_hash_seed/z_hash_set_seed.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZHASH_H
+#define ZHASH_H
+
+#include "zcommon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-process seed, randomised on first use unless Z_HASH_FIXED_SEED is set.
+uint64_t z_hash_seed(void);
+
+// Overrides the process seed. Call before any container hashes with it.
+void z_hash_set_seed(uint64_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ZHASH_P0_ 0x2d358dccaa6c78a5ull
+#define ZHASH_P1_ 0x8bb84b93962eacc9ull
+#define ZHASH_P2_ 0x4b33a62ed433d4a3ull
+#define ZHASH_P3_ 0x4d5a2da51de1aa47ull
+
+// 64x64 -> 128 multiply; low and high halves returned in place.
+static inline void zhash_mum_(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t zhash_mix_(uint64_t a, uint64_t b)
+{
+    zhash_mum_(&a, &b);
+    return a ^ b;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#   define ZHASH_LE64_(v) __builtin_bswap64(v)
+#   define ZHASH_LE32_(v) __builtin_bswap32(v)
+#else
+#   define ZHASH_LE64_(v) (v)
+#   define ZHASH_LE32_(v) (v)
+#endif
+
+static inline uint64_t zhash_r8_(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return ZHASH_LE64_(v);
+}
+
+static inline uint64_t zhash_r4_(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ZHASH_LE32_(v);
+}
+
+// Reads 1..3 bytes.
+static inline uint64_t zhash_r3_(const uint8_t *p, size_t k)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+// One 48-byte stripe of the bulk loop.
+static inline void zhash_stripe_(const uint8_t *p, uint64_t *seed, uint64_t *see1, uint64_t *see2)
+{
+    *seed = zhash_mix_(zhash_r8_(p) ^ ZHASH_P1_, zhash_r8_(p + 8) ^ *seed);
+    *see1 = zhash_mix_(zhash_r8_(p + 16) ^ ZHASH_P2_, zhash_r8_(p + 24) ^ *see1);
+    *see2 = zhash_mix_(zhash_r8_(p + 32) ^ ZHASH_P3_, zhash_r8_(p + 40) ^ *see2);
+}
+
+/* * Finishes a hash over the last `i` (1..48) bytes at `p`.
+ * Inputs longer than 16 bytes may read up to 15 bytes before `p`.
+ */
+static inline uint64_t zhash_finish_(const uint8_t *p, size_t i, uint64_t seed, uint64_t total)
+{
+    while (Z_UNLIKELY(i > 16))
+    {
+        seed = zhash_mix_(zhash_r8_(p) ^ ZHASH_P1_, zhash_r8_(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+    }
+    uint64_t a = zhash_r8_(p + i - 16) ^ ZHASH_P1_;
+    uint64_t b = zhash_r8_(p + i - 8) ^ seed;
+    zhash_mum_(&a, &b);
+    return zhash_mix_(a ^ ZHASH_P0_ ^ total, b ^ ZHASH_P1_);
+}
+
+static inline uint64_t z_hash_bytes(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    seed ^= zhash_mix_(seed ^ ZHASH_P0_, ZHASH_P1_);
+    if (Z_LIKELY(len <= 16))
+    {
+        uint64_t a = 0, b = 0;
+        if (Z_LIKELY(len >= 4))
+        {
+            a = (zhash_r4_(p) << 32) | zhash_r4_(p + ((len >> 3) << 2));
+            b = (zhash_r4_(p + len - 4) << 32) | zhash_r4_(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (Z_LIKELY(len > 0))
+        {
+            a = zhash_r3_(p, len);
+        }
+        a ^= ZHASH_P1_;
+        b ^= seed;
+        zhash_mum_(&a, &b);
+        return zhash_mix_(a ^ ZHASH_P0_ ^ len, b ^ ZHASH_P1_);
+    }
+    size_t i = len;
+    if (Z_UNLIKELY(i > 48))
+    {
+        uint64_t see1 = seed, see2 = seed;
+        do
+        {
+            zhash_stripe_(p, &seed, &see1, &see2);
+            p += 48;
+            i -= 48;
+        } while (Z_LIKELY(i > 48));
+        seed ^= see1 ^ see2;
+    }
+    return zhash_finish_(p, i, seed, len);
+}
+
+static inline uint64_t z_hash_str(const char *s, uint64_t seed)
+{
+    return z_hash_bytes(s, strlen(s), seed);
+}
+
+// Integer mixers: a single 64x64->128 multiply, no function pointers.
+static inline uint64_t z_hash_u64(uint64_t x, uint64_t seed)
+{
+    return zhash_mix_(x ^ ZHASH_P0_, seed ^ ZHASH_P1_);
+}
+
+static inline uint64_t z_hash_u32(uint32_t x, uint64_t seed)
+{
+    return z_hash_u64(((uint64_t)x << 32) | x, seed);
+}
+
+static inline uint64_t z_hash_ptr(const void *ptr, uint64_t seed)
+{
+    return z_hash_u64((uint64_t)(uintptr_t)ptr, seed);
+}
+
+// Folds two hashes (e.g. hashes of key parts) into one.
+static inline uint64_t z_hash_combine(uint64_t h, uint64_t v)
+{
+    return zhash_mix_(h ^ ZHASH_P2_, v ^ ZHASH_P3_);
+}
+
+/* * Streaming state. `buf` keeps the 16 bytes preceding the pending input
+ * because the final step of the hash may read back into them.
+ */
+typedef struct z_hash_state {
+    uint64_t seed;        // As given (short inputs rehash from scratch).
+    uint64_t mixed;       // Running stripe state.
+    uint64_t see1;
+    uint64_t see2;
+    uint64_t total;
+    size_t pending;       // Bytes waiting at buf + 16 (at most 64).
+    uint8_t buf[16 + 64];
+} z_hash_state;
+
+static inline void z_hash_init(z_hash_state *st, uint64_t seed)
+{
+    st->seed = seed;
+    st->mixed = seed ^ zhash_mix_(seed ^ ZHASH_P0_, ZHASH_P1_);
+    st->see1 = st->mixed;
+    st->see2 = st->mixed;
+    st->total = 0;
+    st->pending = 0;
+}
+
+static inline void z_hash_update(z_hash_state *st, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    st->total += len;
+
+    // Top up the buffer; stripes are consumed only while more than 48 bytes wait.
+    size_t copied = 0;
+    while (len > 0)
+    {
+        size_t room = 64 - st->pending;
+        size_t take = len < room ? len : room;
+        memcpy(st->buf + 16 + st->pending, p, take);
+        st->pending += take;
+        copied += take;
+        p += take;
+        len -= take;
+        if (st->pending <= 48)
+        {
+            break;
+        }
+        zhash_stripe_(st->buf + 16, &st->mixed, &st->see1, &st->see2);
+        st->pending -= 48;
+        memmove(st->buf, st->buf + 48, 16 + st->pending);
+
+        // Pending bytes came from this input: rewind and stripe straight from it.
+        if (st->pending <= copied && len + st->pending > 48)
+        {
+            p -= st->pending;
+            len += st->pending;
+            do
+            {
+                zhash_stripe_(p, &st->mixed, &st->see1, &st->see2);
+                p += 48;
+                len -= 48;
+            } while (len > 48);
+            memcpy(st->buf, p - 16, 16 + len);
+            st->pending = len;
+            break;
+        }
+    }
+}
+
+static inline uint64_t z_hash_final(const z_hash_state *st)
+{
+    if (st->total <= 48)
+    {
+        return z_hash_bytes(st->buf + 16, (size_t)st->total, st->seed);
+    }
+    return zhash_finish_(st->buf + 16, st->pending, st->mixed ^ st->see1 ^ st->see2, st->total);
+}
+
+#endif // ZHASH_H
+
+#ifdef ZHASH_IMPLEMENTATION
+#ifndef ZHASH_IMPLEMENTATION_DONE
+#define ZHASH_IMPLEMENTATION_DONE
+
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#   include <stdio.h>
+#endif
+
+static Z_ATOMIC(uint64_t) zhash_process_seed_;   // 0 = not yet chosen.
+
+static uint64_t zhash_entropy_(void)
+{
+    uint64_t e = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f)
+    {
+        if (1 != fread(&e, sizeof(e), 1, f))
+        {
+            e = 0;
+        }
+        fclose(f);
+    }
+#endif
+    // Mix in ASLR and clocks so the seed varies even without /dev/urandom.
+    int local = 0;
+    e = z_hash_combine(e, (uint64_t)(uintptr_t)&local);
+    e = z_hash_combine(e, (uint64_t)(uintptr_t)&zhash_process_seed_);
+    e = z_hash_combine(e, (uint64_t)time(NULL));
+    e = z_hash_combine(e, (uint64_t)clock());
+    return e ? e : ZHASH_P0_;
+}
+
+uint64_t z_hash_seed(void)
+{
+    uint64_t s = Z_ATOMIC_LOAD(&zhash_process_seed_, Z_MO_ACQUIRE);
+    if (Z_LIKELY(0 != s))
+    {
+        return s;
+    }
+#ifdef Z_HASH_FIXED_SEED
+    uint64_t fresh = ZHASH_P0_;
+#else
+    uint64_t fresh = zhash_entropy_();
+#endif
+    // The first thread to publish wins so every caller sees one seed.
+    uint64_t expected = 0;
+    if (Z_ATOMIC_CAS(&zhash_process_seed_, &expected, fresh, Z_MO_ACQ_REL, Z_MO_ACQUIRE))
+    {
+        return fresh;
+    }
+    return expected;
+}
+
+void z_hash_set_seed(uint64_t seed)
+{
+    seed = seed ? seed : ZHASH_P0_;
+    Z_ATOMIC_STORE(&zhash_process_seed_, seed, Z_MO_RELEASE);
+}
+
+#endif // ZHASH_IMPLEMENTATION_DONE
+#endif // ZHASH_IMPLEMENTATION
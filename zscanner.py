@@ -1,107 +1,671 @@
 import os
 import re
+import json
+import hashlib
 import argparse
 import sys
+from concurrent.futures import ProcessPoolExecutor
 
 # Regex patterns to capture the type definitions
 # Capture groups: (ActualType, ShortName)
 REGEX_VEC    = re.compile(r"DEFINE_VEC_TYPE\s*\(\s*(.+?)\s*,\s*(\w+)\s*\)")
 REGEX_LIST   = re.compile(r"DEFINE_LIST_TYPE\s*\(\s*(.+?)\s*,\s*(\w+)\s*\)")
 
+# Capture groups: (ActualType, InlineCount, ShortName)
+REGEX_SMALL_VEC = re.compile(r"DEFINE_SMALL_VEC_TYPE\s*\(\s*(.+?)\s*,\s*(\w+)\s*,\s*(\w+)\s*\)")
+
 # Capture groups: (KeyType, ValType, ShortName)
 REGEX_MAP        = re.compile(r"DEFINE_MAP_TYPE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(\w+)\s*\)")
 REGEX_STABLE_MAP = re.compile(r"DEFINE_STABLE_MAP_TYPE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(\w+)\s*\)")
 
+# Capture groups: (TargetType, Alias) for plain `typedef int32_t EntityId;` lines
+REGEX_TYPEDEF    = re.compile(r"\btypedef\s+((?:[A-Za-z_]\w*[\s\*]+)+?)([A-Za-z_]\w*)\s*;")
+
 # Files to ignore...
 IGNORE_FILES = {"zvec.h", "zlist.h", "zmap.h", "zstr.h", "zcommon.h", "zerror.h"}
 
-def scan_directory(root_dir, output_file_name):
+SOURCE_EXTENSIONS = (".c", ".h", ".cpp", ".hpp", ".cc", ".cxx")
+
+# Bump when the cached match format changes so stale caches are ignored.
+CACHE_VERSION = 3
+
+# Below this many files to (re)scan, a process pool costs more than it saves.
+PARALLEL_THRESHOLD = 64
+
+# Split mode: X-macro list and implementing header for each container kind.
+KIND_LISTS = {
+    "VEC": "Z_AUTOGEN_VECS",
+    "LIST": "Z_AUTOGEN_LISTS",
+    "SMALL_VEC": "Z_AUTOGEN_SMALL_VECS",
+    "MAP": "Z_AUTOGEN_MAPS",
+    "STABLE_MAP": "Z_AUTOGEN_STABLE_MAPS",
+}
+CONTAINER_HEADERS = {
+    "VEC": "zvec.h",
+    "LIST": "zlist.h",
+    "SMALL_VEC": "zvec.h",
+    "MAP": "zmap.h",
+    "STABLE_MAP": "zmap.h",
+}
+# Kinds whose marker carries an inline element count after the type.
+SIZED_KINDS = ("SMALL_VEC",)
+HEADER_EXTENSIONS = (".h", ".hpp", ".hh", ".hxx")
+UNIT_PREFIX = "z_registry_"
+
+# Type canonicalisation: spellings of the same builtin, keyed by sorted words.
+TYPE_TOKEN = re.compile(r"[A-Za-z_]\w*|\S")
+TYPE_QUALIFIERS = ("const", "volatile", "restrict")
+BUILTIN_WORDS = {"signed", "unsigned", "char", "short", "int", "long", "float", "double", "_Bool", "bool"}
+BUILTIN_TYPES = {}
+for _canon, _spellings in {
+    "char": ["char"],
+    "signed char": ["signed char"],
+    "unsigned char": ["unsigned char"],
+    "short": ["short", "short int", "signed short", "signed short int"],
+    "unsigned short": ["unsigned short", "unsigned short int"],
+    "int": ["int", "signed", "signed int"],
+    "unsigned int": ["unsigned", "unsigned int"],
+    "long": ["long", "long int", "signed long", "signed long int"],
+    "unsigned long": ["unsigned long", "unsigned long int"],
+    "long long": ["long long", "long long int", "signed long long", "signed long long int"],
+    "unsigned long long": ["unsigned long long", "unsigned long long int"],
+    "float": ["float"],
+    "double": ["double"],
+    "long double": ["long double"],
+    "_Bool": ["_Bool", "bool"],
+}.items():
+    for _s in _spellings:
+        BUILTIN_TYPES[tuple(sorted(_s.split()))] = _canon
+
+# Fixed-width typedefs that name the same type on every ABI ZDK targets.
+# 64-bit ones are `long` on LP64 and `long long` on LLP64, so they stay distinct.
+TYPE_ALIASES = {
+    "int8_t": "signed char",
+    "uint8_t": "unsigned char",
+    "int16_t": "short",
+    "uint16_t": "unsigned short",
+    "int32_t": "int",
+    "uint32_t": "unsigned int",
+}
+
+# Per-type traits. Canonical names only; anything else (structs, unions,
+# enums, unknown typedefs) is assumed to need the generic paths.
+INTEGER_TYPES = {
+    "_Bool", "char", "signed char", "unsigned char", "short", "unsigned short",
+    "int", "unsigned int", "long", "unsigned long", "long long", "unsigned long long",
+    "int64_t", "uint64_t", "intptr_t", "uintptr_t", "intmax_t", "uintmax_t",
+    "size_t", "ssize_t", "ptrdiff_t",
+}
+FLOAT_TYPES = {"float", "double", "long double"}
+# At most 8 bytes on every supported ABI.
+SMALL_TYPES = (INTEGER_TYPES - {"intmax_t", "uintmax_t"}) | {"float", "double"}
+TRAIT_NAMES = ("TRIVIAL", "INT_KEY", "SMALL", "ZERO_EMPTY")
+
+def scan_content(content):
+    """
+    Returns every marker found in `content`, grouped by container kind.
+    """
+    return {
+        "VEC": REGEX_VEC.findall(content),
+        "LIST": REGEX_LIST.findall(content),
+        "SMALL_VEC": REGEX_SMALL_VEC.findall(content),
+        "MAP": REGEX_MAP.findall(content),
+        "STABLE_MAP": REGEX_STABLE_MAP.findall(content),
+        "TYPEDEF": REGEX_TYPEDEF.findall(content),
+    }
+
+def scan_file(path):
+    """
+    Reads and scans one file. Returns (path, content_hash, matches, error).
+    Runs in worker processes, so it only touches its arguments.
+    """
+    try:
+        with open(path, 'rb') as f:
+            data = f.read()
+        digest = hashlib.blake2b(data, digest_size=16).hexdigest()
+        return path, digest, scan_content(data.decode('utf-8')), None
+    except Exception as e:
+        return path, None, None, str(e)
+
+def load_cache(cache_path):
+    if not cache_path or not os.path.exists(cache_path):
+        return {}
+    try:
+        with open(cache_path, 'r', encoding='utf-8') as f:
+            data = json.load(f)
+        if data.get("version") != CACHE_VERSION:
+            return {}
+        return data.get("files", {})
+    except (OSError, ValueError):
+        # A corrupt cache only costs a full rescan.
+        return {}
+
+def save_cache(cache_path, files):
+    if not cache_path:
+        return
+    cache_dir = os.path.dirname(cache_path)
+    if cache_dir:
+        os.makedirs(cache_dir, exist_ok=True)
+    tmp = cache_path + ".tmp"
+    with open(tmp, 'w', encoding='utf-8') as f:
+        json.dump({"version": CACHE_VERSION, "files": files}, f)
+    os.replace(tmp, cache_path)
+
+def collect_files(root_dir, output_file_name):
+    out_name = os.path.basename(output_file_name)
+    found = []
+    for dirpath, _, filenames in os.walk(root_dir):
+        for fname in filenames:
+            if fname.endswith(SOURCE_EXTENSIONS):
+                if fname in IGNORE_FILES or fname == out_name:
+                    continue
+                found.append(os.path.join(dirpath, fname))
+    found.sort()
+    return found
+
+def scan_directory(root_dir, output_file_name, cache_path=None, jobs=1, origins=None):
+    """
+    Scans `root_dir` for container markers.
+
+    With `cache_path`, files whose mtime and size match the cache are not
+    read at all, and files whose content hash matches are not re-scanned.
+    `jobs` > 1 scans the remaining files in that many worker processes.
+    If `origins` is a dict, it maps each (kind, match) to the files using it.
+    """
     registry = {
         "VEC": set(),
         "LIST": set(),
+        "SMALL_VEC": set(),
         "MAP": set(),
         "STABLE_MAP": set(),
+        "TYPEDEF": set(),
     }
-    
+
     print(f"Scanning {root_dir}...")
 
-    for dirpath, _, filenames in os.walk(root_dir):
-        for fname in filenames:
-            if fname.endswith((".c", ".h", ".cpp", ".hpp", ".cc", ".cxx")):
-                
-                if fname in IGNORE_FILES or fname == os.path.basename(output_file_name):
-                    continue
+    cache = load_cache(cache_path)
+    new_cache = {}
+    results = {}
+    pending = []
 
-                path = os.path.join(dirpath, fname)
-                try:
-                    with open(path, 'r', encoding='utf-8') as f:
-                        content = f.read()
-                        
-                        for match in REGEX_VEC.findall(content):
-                            registry["VEC"].add(match)
+    for path in collect_files(root_dir, output_file_name):
+        try:
+            st = os.stat(path)
+        except OSError as e:
+            print(f"Skipping {os.path.basename(path)}: {e}")
+            continue
+        entry = cache.get(path)
+        if entry and entry["mtime_ns"] == st.st_mtime_ns and entry["size"] == st.st_size:
+            results[path] = entry["matches"]
+            new_cache[path] = entry
+        else:
+            pending.append((path, st, entry))
 
-                        for match in REGEX_LIST.findall(content):
-                            registry["LIST"].add(match)
+    cached = len(results)
+    failed = 0
+    if pending:
+        paths = [p for p, _, _ in pending]
+        if jobs > 1 and len(paths) >= PARALLEL_THRESHOLD:
+            chunk = max(1, len(paths) // (jobs * 8))
+            with ProcessPoolExecutor(max_workers=jobs) as pool:
+                scanned = list(pool.map(scan_file, paths, chunksize=chunk))
+        else:
+            scanned = [scan_file(p) for p in paths]
 
-                        for match in REGEX_MAP.findall(content):
-                            registry["MAP"].add(match)
+        for (path, st, entry), (_, digest, matches, error) in zip(pending, scanned):
+            if error is not None:
+                print(f"Skipping {os.path.basename(path)}: {error}")
+                failed += 1
+                continue
+            # Touched but unchanged: keep the cached matches, refresh the stamp.
+            if entry and entry["hash"] == digest:
+                matches = entry["matches"]
+            results[path] = matches
+            new_cache[path] = {
+                "mtime_ns": st.st_mtime_ns,
+                "size": st.st_size,
+                "hash": digest,
+                "matches": matches,
+            }
 
-                        for match in REGEX_STABLE_MAP.findall(content):
-                            registry["STABLE_MAP"].add(match)
+    for path, matches in results.items():
+        for kind, found in matches.items():
+            for match in found:
+                registry[kind].add(tuple(match))
+                if origins is not None:
+                    origins.setdefault((kind, tuple(match)), set()).add(path)
 
-                except Exception as e:
-                    print(f"Skipping {fname}: {e}")
+    if cache_path:
+        print(f"  {cached} cached, {len(pending) - failed} scanned, {failed} failed.")
+        if pending or len(new_cache) != len(cache):
+            save_cache(cache_path, new_cache)
 
     return registry
 
-def generate_header(registry, output_file):
-    print(f"Generating {output_file}...")
+def normalise_type(type_t):
+    """
+    One spelling per token sequence: single spaces between words, `*` bound
+    to what follows it (`const char *`, `char **`, `char *const`).
+    """
+    out = ""
+    prev = ""
+    for tok in TYPE_TOKEN.findall(type_t):
+        word = tok[0].isalnum() or tok[0] == "_"
+        if out and ((word and (prev[0].isalnum() or prev[0] == "_")) or
+                    (tok in "*&" and prev not in "*&")):
+            out += " "
+        out += tok
+        prev = tok
+    return out
+
+def canonical_type(type_t, typedefs, depth=0):
+    """
+    Identity key for a type: builtin spellings and aliases collapse to one
+    name, and known project typedefs are resolved. Unknown types keep their
+    normalised spelling.
+    """
+    tokens = TYPE_TOKEN.findall(type_t)
+    star = tokens.index("*") if "*" in tokens else len(tokens)
+    spec, tail = tokens[:star], tokens[star:]
+    quals = [q for q in TYPE_QUALIFIERS if q in spec]
+    words = [t for t in spec if t not in TYPE_QUALIFIERS]
+
+    base = None
+    if words and all(w in BUILTIN_WORDS for w in words):
+        base = BUILTIN_TYPES.get(tuple(sorted(words)))
+    elif len(words) == 1:
+        base = TYPE_ALIASES.get(words[0])
+        target = typedefs.get(words[0])
+        if base is None and target is not None and depth < 8:
+            resolved = canonical_type(target, typedefs, depth + 1)
+            # `const T` over a pointer typedef qualifies the pointer; keep it opaque.
+            if not (quals and "*" in resolved):
+                base = resolved
+    if base is None:
+        base = " ".join(words)
+
+    return normalise_type(" ".join(quals + [base] + tail))
+
+def collect_typedefs(found):
+    """
+    Alias -> target from scanned `typedef` lines. Names typedef'd to
+    different types in different files (per-platform headers) are dropped.
+    """
+    typedefs = {}
+    ambiguous = set()
+    for target, alias in found:
+        target = normalise_type(target)
+        if alias in typedefs and typedefs[alias] != target:
+            ambiguous.add(alias)
+        typedefs[alias] = target
+    for alias in ambiguous:
+        del typedefs[alias]
+    return typedefs
+
+def match_types(kind, match):
+    # The type arguments of a marker; sized kinds have a count after the type.
+    return match[:1] if kind in SIZED_KINDS else match[:-1]
+
+def canonicalise_registry(registry, origins=None):
+    """
+    Normalises every type spelling and collapses registrations that have
+    the same canonical types under different names (`unsigned` / `uint32_t`).
+    Signedness is kept apart: sorting, min/max and searching compare values.
+
+    Small vectors also need the same inline count. The first name of each
+    group keeps the implementation; the others are returned as aliases
+    (X(Primary, T..., Name)) for the containers to wrap. `origins` is
+    re-keyed to the surviving entries.
+    Returns (registry, aliases).
+    """
+    typedefs = collect_typedefs(registry.get("TYPEDEF", ()))
+    result = {kind: set() for kind in KIND_LISTS}
+    aliases = {kind: set() for kind in KIND_LISTS}
+    remapped = {}
+
+    for kind in KIND_LISTS:
+        by_name = {}
+        for match in registry[kind]:
+            types = tuple(normalise_type(t) for t in match_types(kind, match))
+            counts = tuple(c.strip() for c in match[len(types):-1])
+            name = match[-1]
+            entry = types + counts + (name,)
+            canon = tuple(canonical_type(t, typedefs) for t in types) + counts
+            prev = by_name.get(name)
+            if prev is not None:
+                if prev[1] != canon:
+                    print(f"  Warning: {kind} {name} registered as both {prev[0][:-1]} and {entry[:-1]}.")
+                    result[kind].add(entry)
+                else:
+                    # Same type spelled twice under one name: one entry is enough.
+                    entry = prev[0]
+                for path in (origins or {}).get((kind, match), ()):
+                    remapped.setdefault((kind, entry), set()).add(path)
+                continue
+            by_name[name] = (entry, canon)
+            for path in (origins or {}).get((kind, match), ()):
+                remapped.setdefault((kind, entry), set()).add(path)
+
+        groups = {}
+        for name in sorted(by_name):
+            entry, canon = by_name[name]
+            groups.setdefault(canon, []).append((entry, canon))
 
-    output_dir = os.path.dirname(output_file)
+        for members in groups.values():
+            # Prefer a primary spelled as the canonical type, so its
+            # implementation unit needs no project headers.
+            members.sort(key=lambda m: (m[0][:-1] != m[1], m[0][-1]))
+            primary = members[0][0]
+            result[kind].add(primary)
+            for entry, _ in members[1:]:
+                aliases[kind].add((primary[-1],) + entry)
+                print(f"  Duplicate {kind} {entry[-1]} -> {primary[-1]}.")
+                for path in remapped.pop((kind, entry), ()):
+                    remapped.setdefault((kind, primary), set()).add(path)
+
+    if origins is not None:
+        origins.clear()
+        origins.update(remapped)
+    return result, aliases
+
+def type_traits(registry, typedefs, trivial=()):
+    """
+    Name -> {trait: 0/1} for every registration:
+
+      TRIVIAL     every type is trivially copyable (memcpy moves are fine);
+      INT_KEY     the map key, or the vector/list element, is an integer;
+      SMALL       every type is at most 8 bytes;
+      ZERO_EMPTY  all-zero bytes are a valid value of every type (calloc init).
+
+    Scalars and pointers qualify; other types only count as TRIVIAL when
+    listed in `trivial`.
+    """
+    trivial = {canonical_type(t, typedefs) for t in trivial}
+    traits = {}
+    for kind in KIND_LISTS:
+        for match in registry[kind]:
+            canon = []
+            for t in match_types(kind, match):
+                c = canonical_type(t, typedefs)
+                # Qualifiers do not change the representation.
+                words = [w for w in c.split(" ") if w not in TYPE_QUALIFIERS]
+                canon.append(" ".join(words))
+            scalar = [c in INTEGER_TYPES or c in FLOAT_TYPES or c.endswith("*") for c in canon]
+            traits[match[-1]] = {
+                "TRIVIAL": int(all(sc or c in trivial for sc, c in zip(scalar, canon))),
+                "INT_KEY": int(canon[0] in INTEGER_TYPES),
+                "SMALL": int(all(c in SMALL_TYPES or c.endswith("*") for c in canon)),
+                "ZERO_EMPTY": int(all(scalar)),
+            }
+    return traits
+
+def render_traits(names, traits):
+    # Z_TRAIT_<Name>_<TRAIT>: containers paste Z_TRAIT_##Name##_TRIVIAL etc.
+    out = []
+    for name in names:
+        for trait in TRAIT_NAMES:
+            out.append(f"#define Z_TRAIT_{name}_{trait} {traits[name][trait]}\n")
+    return out
+
+def render_header(registry, split=False, aliases=None, traits=None):
+    out = []
+    out.append("/* AUTO-GENERATED BY Z-SCANNER - DO NOT EDIT */\n")
+    out.append("#ifndef Z_REGISTRY_H\n")
+    out.append("#define Z_REGISTRY_H\n\n")
+
+    if split:
+        # Containers expanding the lists emit prototypes only; the bodies are
+        # compiled once, in the generated z_registry_*.c units.
+        out.append("/* Split mode: definitions live in the generated z_registry_*.c units */\n")
+        out.append("#define Z_REGISTRY_SPLIT 1\n")
+        out.append("#ifndef Z_REGISTRY_IMPLEMENTATION\n")
+        out.append("#   define Z_REGISTRY_DECLARE_ONLY 1\n")
+        out.append("#   define Z_REGISTRY_LINKAGE extern\n")
+        out.append("#endif\n\n")
+
+    # VECTORS
+    out.append("/* Vectors */\n")
+    out.append("#define Z_AUTOGEN_VECS(X) \\\n")
+    for type_t, name in sorted(registry["VEC"], key=lambda x: (x[-1], x)):
+        out.append(f"    X({type_t.strip()}, {name}) \\\n")
+    out.append("\n")
+
+    # LISTS
+    out.append("/* Lists */\n")
+    out.append("#define Z_AUTOGEN_LISTS(X) \\\n")
+    for type_t, name in sorted(registry["LIST"], key=lambda x: (x[-1], x)):
+        out.append(f"    X({type_t.strip()}, {name}) \\\n")
+    out.append("\n")
+
+    # SMALL VECTORS
+    out.append("/* Small Vectors: X(T, N, Name) keeps N elements inline */\n")
+    out.append("#define Z_AUTOGEN_SMALL_VECS(X) \\\n")
+    for type_t, count, name in sorted(registry["SMALL_VEC"], key=lambda x: (x[-1], x)):
+        out.append(f"    X({type_t.strip()}, {count.strip()}, {name}) \\\n")
+    out.append("\n")
+
+    # MAPS
+    out.append("/* Maps */\n")
+    out.append("#define Z_AUTOGEN_MAPS(X) \\\n")
+    for key_t, val_t, name in sorted(registry["MAP"], key=lambda x: (x[-1], x)):
+        out.append(f"    X({key_t.strip()}, {val_t.strip()}, {name}) \\\n")
+    out.append("\n")
+
+    # STABLE MAPS
+    out.append("/* Stable Maps */\n")
+    out.append("#define Z_AUTOGEN_STABLE_MAPS(X) \\\n")
+    for key_t, val_t, name in sorted(registry["STABLE_MAP"], key=lambda x: (x[-1], x)):
+        out.append(f"    X({key_t.strip()}, {val_t.strip()}, {name}) \\\n")
+    out.append("\n")
+
+    if aliases is not None:
+        # Each alias reuses its primary's implementation through thin wrappers.
+        out.append("/* Aliases: X(Primary, T, Name), X(Primary, T, N, Name) and X(Primary, K, V, Name) */\n")
+        for kind, list_macro in KIND_LISTS.items():
+            out.append(f"#define {alias_list(list_macro)}(X) \\\n")
+            for alias in sorted(aliases[kind], key=lambda x: x[-1]):
+                out.append(f"    X({', '.join(alias)}) \\\n")
+            out.append("\n")
+
+    if split:
+        # A unit defines the lists it compiles before including this header;
+        # any other Z_REGISTRY_IMPLEMENTATION source compiles every type.
+        out.append("/* Bodies compiled under Z_REGISTRY_IMPLEMENTATION */\n")
+        lists = list(KIND_LISTS.values())
+        if aliases is not None:
+            lists += [alias_list(m) for m in KIND_LISTS.values()]
+        for list_macro in lists:
+            out.append(f"#ifndef {impl_list(list_macro)}\n")
+            out.append(f"#   define {impl_list(list_macro)} {list_macro}\n")
+            out.append("#endif\n")
+        out.append("\n")
+
+    if traits is not None:
+        out.append("/* Traits: Z_TRAIT_<Name>_{TRIVIAL,INT_KEY,SMALL,ZERO_EMPTY} */\n")
+        out.append("#define Z_REGISTRY_TRAITS 1\n")
+        out.extend(render_traits(sorted(traits), traits))
+        out.append("\n")
+
+    out.append("#endif // Z_REGISTRY_H\n")
+    return "".join(out)
+
+def alias_list(list_macro):
+    # Z_AUTOGEN_VECS -> Z_AUTOGEN_VEC_ALIASES
+    return list_macro[:-1] + "_ALIASES"
+
+def impl_list(list_macro):
+    # Z_AUTOGEN_VECS -> Z_AUTOGEN_VECS_IMPL
+    return list_macro + "_IMPL"
+
+def format_entry(kind, match):
+    if kind in ("VEC", "LIST"):
+        type_t, name = match
+        return f"X({type_t.strip()}, {name})"
+    if kind == "SMALL_VEC":
+        type_t, count, name = match
+        return f"X({type_t.strip()}, {count.strip()}, {name})"
+    key_t, val_t, name = match
+    return f"X({key_t.strip()}, {val_t.strip()}, {name})"
+
+def shard_of(name, shards):
+    # Hash the name so adding a type does not move every other type.
+    digest = hashlib.blake2b(name.encode('utf-8'), digest_size=8).digest()
+    return int.from_bytes(digest, 'little') % shards
+
+def plan_units(registry, shards=0):
+    """
+    Groups registered types into implementation units.
+    Returns {file_name: [(kind, match), ...]}. `shards` = 0 gives one unit per type.
+    """
+    units = {}
+    for kind in KIND_LISTS:
+        for match in registry[kind]:
+            name = match[-1]
+            if shards > 0:
+                fname = f"{UNIT_PREFIX}shard_{shard_of(name, shards):02d}.c"
+            else:
+                fname = f"{UNIT_PREFIX}{kind.lower()}_{name}.c"
+            units.setdefault(fname, []).append((kind, match))
+    for entries in units.values():
+        entries.sort(key=lambda e: (e[0], e[1][-1]))
+    return units
+
+def render_unit(entries, includes, registry_include, aliases=()):
+    """
+    One translation unit instantiating `entries` and the `aliases` whose
+    primary is among them. It includes the split registry, so every
+    registered type is declared, and narrows only the Z_AUTOGEN_*_IMPL
+    lists to this unit's types.
+    """
+    out = []
+    out.append("/* AUTO-GENERATED BY Z-SCANNER - DO NOT EDIT */\n")
+    out.append("#define Z_REGISTRY_IMPLEMENTATION 1\n")
+    out.append("#define Z_REGISTRY_LINKAGE\n\n")
+
+    for kind, list_macro in KIND_LISTS.items():
+        mine = [m for k, m in entries if k == kind]
+        out.append(f"#define {impl_list(list_macro)}(X) \\\n")
+        for match in mine:
+            out.append(f"    {format_entry(kind, match)} \\\n")
+        out.append("\n")
+        out.append(f"#define {impl_list(alias_list(list_macro))}(X) \\\n")
+        for alias in sorted((a for k, a in aliases if k == kind), key=lambda x: x[-1]):
+            out.append(f"    X({', '.join(alias)}) \\\n")
+        out.append("\n")
+
+    # The lists come first: included headers may expand them through zvec.h etc.
+    out.append(f"#include \"{registry_include}\"\n")
+    for inc in includes:
+        out.append(f"#include \"{inc}\"\n")
+
+    headers = []
+    for kind, _ in entries:
+        if CONTAINER_HEADERS[kind] not in headers:
+            headers.append(CONTAINER_HEADERS[kind])
+    for header in headers:
+        out.append(f"#include \"{header}\"\n")
+    return "".join(out)
+
+def generate_units(registry, unit_dir, registry_header, shards=0, includes=(), origins=None, aliases=None):
+    """
+    Writes the z_registry_*.c units into `unit_dir` (only those whose bytes
+    changed) and deletes units left over from types no longer registered.
+    Each unit includes `registry_header`, then the headers that contain its
+    types' markers, and also compiles the wrappers of its types' aliases.
+    Returns the list of unit paths.
+    """
+    os.makedirs(unit_dir, exist_ok=True)
+    units = plan_units(registry, shards)
+    reg_inc = os.path.relpath(registry_header, unit_dir).replace(os.sep, "/")
+    by_primary = {}
+    for kind, found in (aliases or {}).items():
+        for alias in found:
+            by_primary.setdefault((kind, alias[0]), []).append((kind, alias))
+    written = 0
+    for fname, entries in units.items():
+        incs = list(includes)
+        mine = []
+        for kind, match in entries:
+            mine.extend(by_primary.get((kind, match[-1]), ()))
+            for path in sorted((origins or {}).get((kind, match), ())):
+                if path.endswith(HEADER_EXTENSIONS):
+                    rel = os.path.relpath(path, unit_dir).replace(os.sep, "/")
+                    if rel not in incs:
+                        incs.append(rel)
+        if write_if_changed(os.path.join(unit_dir, fname), render_unit(entries, incs, reg_inc, mine)):
+            written += 1
+
+    removed = 0
+    for fname in os.listdir(unit_dir):
+        if fname.startswith(UNIT_PREFIX) and fname.endswith(".c") and fname not in units:
+            os.remove(os.path.join(unit_dir, fname))
+            removed += 1
+
+    print(f"Units in {unit_dir}: {len(units)} ({written} written, {removed} removed).")
+    return [os.path.join(unit_dir, f) for f in sorted(units)]
+
+def write_if_changed(path, text):
+    """
+    Writes `text` to `path` only if the bytes differ, so an unchanged
+    output keeps its mtime and does not trigger rebuilds.
+    Returns True if the file was written.
+    """
+    data = text.encode('utf-8')
+    try:
+        with open(path, 'rb') as f:
+            if f.read() == data:
+                return False
+    except OSError:
+        pass
+
+    output_dir = os.path.dirname(path)
     if output_dir:
         os.makedirs(output_dir, exist_ok=True)
+    tmp = path + ".tmp"
+    with open(tmp, 'wb') as f:
+        f.write(data)
+    os.replace(tmp, path)
+    return True
 
-    with open(output_file, 'w', encoding='utf-8') as f:
-        f.write("/* AUTO-GENERATED BY Z-SCANNER - DO NOT EDIT */\n")
-        f.write("#ifndef Z_REGISTRY_H\n")
-        f.write("#define Z_REGISTRY_H\n\n")
-
-        # VECTORS
-        f.write("/* Vectors */\n")
-        f.write("#define Z_AUTOGEN_VECS(X) \\\n")
-        for type_t, name in sorted(registry["VEC"], key=lambda x: x[1]):
-            f.write(f"    X({type_t.strip()}, {name}) \\\n")
-        f.write("\n")
-
-        # LISTS
-        f.write("/* Lists */\n")
-        f.write("#define Z_AUTOGEN_LISTS(X) \\\n")
-        for type_t, name in sorted(registry["LIST"], key=lambda x: x[1]):
-            f.write(f"    X({type_t.strip()}, {name}) \\\n")
-        f.write("\n")
-        
-        # MAPS
-        f.write("/* Maps */\n")
-        f.write("#define Z_AUTOGEN_MAPS(X) \\\n")
-        for key_t, val_t, name in sorted(registry["MAP"], key=lambda x: x[2]):
-            f.write(f"    X({key_t.strip()}, {val_t.strip()}, {name}) \\\n")
-        f.write("\n")
-
-        # STABLE MAPS
-        f.write("/* Stable Maps */\n")
-        f.write("#define Z_AUTOGEN_STABLE_MAPS(X) \\\n")
-        for key_t, val_t, name in sorted(registry["STABLE_MAP"], key=lambda x: x[2]):
-            f.write(f"    X({key_t.strip()}, {val_t.strip()}, {name}) \\\n")
-        f.write("\n")
-
-        f.write("#endif // Z_REGISTRY_H\n")
+def generate_header(registry, output_file, split=False, aliases=None, traits=None):
+    if write_if_changed(output_file, render_header(registry, split, aliases, traits)):
+        print(f"Generated {output_file}.")
+        return True
+    print(f"{output_file} is up to date.")
+    return False
 
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(description="Scan C/C++ files for z-lib type definitions.")
     parser.add_argument("src", help="Source directory to scan")
     parser.add_argument("out", help="Output header file (e.g., z_registry.h)")
-    
+    parser.add_argument("--cache", default=None,
+                        help="Scan cache file (default: <out>.cache)")
+    parser.add_argument("--no-cache", action="store_true", help="Always rescan every file")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+                        help="Worker processes for scanning (default: CPU count)")
+    parser.add_argument("--split", metavar="DIR", default=None,
+                        help="Declarations-only registry plus one z_registry_*.c unit per type in DIR")
+    parser.add_argument("--shards", type=int, default=0,
+                        help="With --split, group types into N units instead of one per type")
+    parser.add_argument("--include", action="append", default=[],
+                        help="With --split, header every unit includes first (repeatable)")
+    parser.add_argument("--trivial", action="append", default=[], metavar="TYPE",
+                        help="Treat TYPE (e.g. a POD struct) as trivially copyable (repeatable)")
+    parser.add_argument("--no-traits", action="store_true", help="Do not emit Z_TRAIT_* macros")
+    parser.add_argument("--dedup", action="store_true",
+                        help="Canonicalise type spellings and emit same-type registrations as aliases")
+
     args = parser.parse_args()
-    reg = scan_directory(args.src, args.out)
-    generate_header(reg, args.out)
+    cache_path = None if args.no_cache else (args.cache or args.out + ".cache")
+    origins = {} if args.split else None
+    reg = scan_directory(args.src, args.out, cache_path=cache_path, jobs=args.jobs, origins=origins)
+    traits = None
+    if not args.no_traits:
+        traits = type_traits(reg, collect_typedefs(reg["TYPEDEF"]), args.trivial)
+    aliases = None
+    if args.dedup:
+        reg, aliases = canonicalise_registry(reg, origins)
+    generate_header(reg, args.out, split=bool(args.split), aliases=aliases, traits=traits)
+    if args.split:
+        generate_units(reg, args.split, args.out, args.shards, args.include, origins, aliases)
     print("Done.")
@@ -0,0 +1,617 @@
+/*
+ * zsimd.h — Byte-search kernels with runtime CPU dispatch for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Text-scanning primitives for string, file and tooling code:
+ *   - z_memchr2 / z_memchr3: first occurrence of any of 2 or 3 bytes.
+ *   - z_memmem:               substring search.
+ *   - z_skip_space / z_rskip_space / z_trim: ASCII whitespace trimming.
+ *   - z_next_line:            line splitting (LF or CRLF).
+ *
+ * On x86 the best of AVX-512BW, AVX2 and SSE2 is picked on first use via
+ * CPUID; other targets use the portable scalar kernels. No special compiler
+ * flags are needed: kernels are compiled with per-function target attributes.
+ * Define ZSIMD_FORCE_SCALAR to disable the vector paths.
+ *
+ * Define ZSIMD_IMPLEMENTATION in exactly one translation unit before
+ * including this header.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZSIMD_H
+#define ZSIMD_H
+
+#include "zcommon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Each returns a pointer to the first match in `s[0..n)`, or NULL.
+const char *z_memchr2(const char *s, size_t n, char a, char b);
+const char *z_memchr3(const char *s, size_t n, char a, char b, char c);
+const char *z_memmem(const char *hay, size_t n, const char *needle, size_t m);
+
+// Number of leading whitespace bytes (space, \t, \n, \v, \f, \r).
+size_t z_skip_space(const char *s, size_t n);
+
+// Length of `s` once trailing whitespace is removed.
+size_t z_rskip_space(const char *s, size_t n);
+
+// Name of the selected kernel set: "avx512", "avx2", "sse2" or "scalar".
+const char *z_simd_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Trims `*s`/`*n` in place.
+static inline void z_trim(const char **s, size_t *n)
+{
+    size_t lead = z_skip_space(*s, *n);
+    *s += lead;
+    *n = z_rskip_space(*s, *n - lead);
+}
+
+/* * Splits the next line off `[*cur, end)`. Returns false when exhausted.
+ * The line excludes its terminator; a trailing '\r' is dropped too.
+ */
+static inline bool z_next_line(const char **cur, const char *end, const char **line, size_t *len)
+{
+    if (*cur >= end)
+    {
+        return false;
+    }
+    const char *start = *cur;
+    // libc memchr is already vectorised for the single-byte case.
+    const char *nl = (const char *)memchr(start, '\n', (size_t)(end - start));
+    const char *stop = nl ? nl : end;
+    *cur = nl ? nl + 1 : end;
+    if (stop > start && '\r' == stop[-1])
+    {
+        stop--;
+    }
+    *line = start;
+    *len = (size_t)(stop - start);
+    return true;
+}
+
+#endif // ZSIMD_H
+
+#ifdef ZSIMD_IMPLEMENTATION
+#ifndef ZSIMD_IMPLEMENTATION_DONE
+#define ZSIMD_IMPLEMENTATION_DONE
+
+#if !defined(ZSIMD_FORCE_SCALAR) && !defined(__TINYC__) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#   define ZSIMD_X86_ 1
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#       define ZSIMD_TARGET_(isa)
+#   else
+#       define ZSIMD_TARGET_(isa) __attribute__((target(isa)))
+#   endif
+#   if !defined(ZSIMD_NO_AVX512) && (defined(__clang__) || defined(_MSC_VER) || (defined(__GNUC__) && __GNUC__ >= 6))
+#       define ZSIMD_AVX512_ 1
+#   endif
+#else
+#   define ZSIMD_X86_ 0
+#endif
+
+// Bit scans on non-zero masks.
+#if defined(_MSC_VER) && !defined(__clang__)
+static inline unsigned zsimd_ctz32_(uint32_t m) { unsigned long i; _BitScanForward(&i, m); return (unsigned)i; }
+static inline unsigned zsimd_hib32_(uint32_t m) { unsigned long i; _BitScanReverse(&i, m); return (unsigned)i; }
+static inline unsigned zsimd_ctz64_(uint64_t m)
+{
+    uint32_t lo = (uint32_t)m;
+    return lo ? zsimd_ctz32_(lo) : 32 + zsimd_ctz32_((uint32_t)(m >> 32));
+}
+#else
+static inline unsigned zsimd_ctz32_(uint32_t m) { return (unsigned)__builtin_ctz(m); }
+static inline unsigned zsimd_hib32_(uint32_t m) { return 31u - (unsigned)__builtin_clz(m); }
+static inline unsigned zsimd_ctz64_(uint64_t m) { return (unsigned)__builtin_ctzll(m); }
+#endif
+
+static inline bool zsimd_is_space_(unsigned char c)
+{
+    return ' ' == c || (unsigned char)(c - 9) < 5;
+}
+
+// Scalar kernels (also used for tails).
+
+static const char *zsimd_memchr2_scalar_(const char *s, size_t n, char a, char b)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (s[i] == a || s[i] == b)
+        {
+            return s + i;
+        }
+    }
+    return NULL;
+}
+
+static const char *zsimd_memchr3_scalar_(const char *s, size_t n, char a, char b, char c)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (s[i] == a || s[i] == b || s[i] == c)
+        {
+            return s + i;
+        }
+    }
+    return NULL;
+}
+
+static const char *zsimd_memmem_scalar_(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (0 == m)
+    {
+        return hay;
+    }
+    const char *p = hay;
+    const char *end = hay + n;
+    while ((size_t)(end - p) >= m)
+    {
+        p = (const char *)memchr(p, needle[0], (size_t)(end - p) - m + 1);
+        if (!p)
+        {
+            return NULL;
+        }
+        if (0 == memcmp(p + 1, needle + 1, m - 1))
+        {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+static size_t zsimd_skip_space_scalar_(const char *s, size_t n)
+{
+    size_t i = 0;
+    while (i < n && zsimd_is_space_((unsigned char)s[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+static size_t zsimd_rskip_space_scalar_(const char *s, size_t n)
+{
+    while (n > 0 && zsimd_is_space_((unsigned char)s[n - 1]))
+    {
+        n--;
+    }
+    return n;
+}
+
+#if ZSIMD_X86_
+
+// SSE2.
+
+ZSIMD_TARGET_("sse2")
+static const char *zsimd_memchr2_sse2_(const char *s, size_t n, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (m)
+        {
+            return s + i + zsimd_ctz32_(m);
+        }
+    }
+    return zsimd_memchr2_scalar_(s + i, n - i, a, b);
+}
+
+ZSIMD_TARGET_("sse2")
+static const char *zsimd_memchr3_sse2_(const char *s, size_t n, char a, char b, char c)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                  _mm_cmpeq_epi8(v, vc));
+        uint32_t m = (uint32_t)_mm_movemask_epi8(eq);
+        if (m)
+        {
+            return s + i + zsimd_ctz32_(m);
+        }
+    }
+    return zsimd_memchr3_scalar_(s + i, n - i, a, b, c);
+}
+
+// First/last-byte filter: only candidates matching both ends reach memcmp.
+ZSIMD_TARGET_("sse2")
+static const char *zsimd_memmem_sse2_(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (m < 2 || m > n)
+    {
+        return zsimd_memmem_scalar_(hay, n, needle, m);
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first),
+                                                                  _mm_cmpeq_epi8(bl, last)));
+        while (mask)
+        {
+            unsigned bit = zsimd_ctz32_(mask);
+            if (0 == memcmp(hay + i + bit + 1, needle + 1, m - 2))
+            {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return zsimd_memmem_scalar_(hay + i, n - i, needle, m);
+}
+
+// Whitespace mask: c == ' ' or (c - 9) <= 4 unsigned.
+ZSIMD_TARGET_("sse2")
+static inline uint32_t zsimd_space_mask_sse2_(__m128i v)
+{
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(9));
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                              _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(4)), x));
+    return (uint32_t)_mm_movemask_epi8(ws);
+}
+
+ZSIMD_TARGET_("sse2")
+static size_t zsimd_skip_space_sse2_(const char *s, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        uint32_t m = ~zsimd_space_mask_sse2_(_mm_loadu_si128((const __m128i *)(s + i))) & 0xFFFFu;
+        if (m)
+        {
+            return i + zsimd_ctz32_(m);
+        }
+    }
+    return i + zsimd_skip_space_scalar_(s + i, n - i);
+}
+
+ZSIMD_TARGET_("sse2")
+static size_t zsimd_rskip_space_sse2_(const char *s, size_t n)
+{
+    for (; n >= 16; n -= 16)
+    {
+        uint32_t m = ~zsimd_space_mask_sse2_(_mm_loadu_si128((const __m128i *)(s + n - 16))) & 0xFFFFu;
+        if (m)
+        {
+            return n - 16 + zsimd_hib32_(m) + 1;
+        }
+    }
+    return zsimd_rskip_space_scalar_(s, n);
+}
+
+// AVX2.
+
+ZSIMD_TARGET_("avx2")
+static const char *zsimd_memchr2_avx2_(const char *s, size_t n, char a, char b)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                                                    _mm256_cmpeq_epi8(v, vb)));
+        if (m)
+        {
+            return s + i + zsimd_ctz32_(m);
+        }
+    }
+    return zsimd_memchr2_sse2_(s + i, n - i, a, b);
+}
+
+ZSIMD_TARGET_("avx2")
+static const char *zsimd_memchr3_avx2_(const char *s, size_t n, char a, char b, char c)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                     _mm256_cmpeq_epi8(v, vc));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(eq);
+        if (m)
+        {
+            return s + i + zsimd_ctz32_(m);
+        }
+    }
+    return zsimd_memchr3_sse2_(s + i, n - i, a, b, c);
+}
+
+ZSIMD_TARGET_("avx2")
+static const char *zsimd_memmem_avx2_(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (m < 2 || m > n)
+    {
+        return zsimd_memmem_scalar_(hay, n, needle, m);
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(hay + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first),
+                                                                        _mm256_cmpeq_epi8(bl, last)));
+        while (mask)
+        {
+            unsigned bit = zsimd_ctz32_(mask);
+            if (0 == memcmp(hay + i + bit + 1, needle + 1, m - 2))
+            {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return zsimd_memmem_sse2_(hay + i, n - i, needle, m);
+}
+
+ZSIMD_TARGET_("avx2")
+static inline uint32_t zsimd_space_mask_avx2_(__m256i v)
+{
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(9));
+    __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                 _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(4)), x));
+    return (uint32_t)_mm256_movemask_epi8(ws);
+}
+
+ZSIMD_TARGET_("avx2")
+static size_t zsimd_skip_space_avx2_(const char *s, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        uint32_t m = ~zsimd_space_mask_avx2_(_mm256_loadu_si256((const __m256i *)(s + i)));
+        if (m)
+        {
+            return i + zsimd_ctz32_(m);
+        }
+    }
+    return i + zsimd_skip_space_sse2_(s + i, n - i);
+}
+
+ZSIMD_TARGET_("avx2")
+static size_t zsimd_rskip_space_avx2_(const char *s, size_t n)
+{
+    for (; n >= 32; n -= 32)
+    {
+        uint32_t m = ~zsimd_space_mask_avx2_(_mm256_loadu_si256((const __m256i *)(s + n - 32)));
+        if (m)
+        {
+            return n - 32 + zsimd_hib32_(m) + 1;
+        }
+    }
+    return zsimd_rskip_space_sse2_(s, n);
+}
+
+#   ifdef ZSIMD_AVX512_
+
+// AVX-512BW (byte compares straight into mask registers).
+
+ZSIMD_TARGET_("avx512f,avx512bw")
+static const char *zsimd_memchr2_avx512_(const char *s, size_t n, char a, char b)
+{
+    const __m512i va = _mm512_set1_epi8(a);
+    const __m512i vb = _mm512_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(s + i));
+        uint64_t m = (uint64_t)(_mm512_cmpeq_epi8_mask(v, va) | _mm512_cmpeq_epi8_mask(v, vb));
+        if (m)
+        {
+            return s + i + zsimd_ctz64_(m);
+        }
+    }
+    return zsimd_memchr2_avx2_(s + i, n - i, a, b);
+}
+
+ZSIMD_TARGET_("avx512f,avx512bw")
+static const char *zsimd_memchr3_avx512_(const char *s, size_t n, char a, char b, char c)
+{
+    const __m512i va = _mm512_set1_epi8(a);
+    const __m512i vb = _mm512_set1_epi8(b);
+    const __m512i vc = _mm512_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(s + i));
+        uint64_t m = (uint64_t)(_mm512_cmpeq_epi8_mask(v, va) | _mm512_cmpeq_epi8_mask(v, vb) |
+                                _mm512_cmpeq_epi8_mask(v, vc));
+        if (m)
+        {
+            return s + i + zsimd_ctz64_(m);
+        }
+    }
+    return zsimd_memchr3_avx2_(s + i, n - i, a, b, c);
+}
+
+ZSIMD_TARGET_("avx512f,avx512bw")
+static const char *zsimd_memmem_avx512_(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (m < 2 || m > n)
+    {
+        return zsimd_memmem_scalar_(hay, n, needle, m);
+    }
+    const __m512i first = _mm512_set1_epi8(needle[0]);
+    const __m512i last = _mm512_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 64 <= n; i += 64)
+    {
+        __m512i bf = _mm512_loadu_si512((const void *)(hay + i));
+        __m512i bl = _mm512_loadu_si512((const void *)(hay + i + m - 1));
+        uint64_t mask = (uint64_t)(_mm512_cmpeq_epi8_mask(bf, first) & _mm512_cmpeq_epi8_mask(bl, last));
+        while (mask)
+        {
+            unsigned bit = zsimd_ctz64_(mask);
+            if (0 == memcmp(hay + i + bit + 1, needle + 1, m - 2))
+            {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return zsimd_memmem_avx2_(hay + i, n - i, needle, m);
+}
+
+#   endif // ZSIMD_AVX512_
+
+// CPU feature detection.
+
+#   if defined(_MSC_VER) && !defined(__clang__)
+static int zsimd_detect_(void)
+{
+    int r[4];
+    __cpuid(r, 1);
+    bool sse2 = (r[3] >> 26) & 1;
+    bool osxsave = (r[2] >> 27) & 1;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(r, 7, 0);
+    bool avx2 = osxsave && (xcr0 & 0x6) == 0x6 && ((r[1] >> 5) & 1);
+    bool avx512 = avx2 && (xcr0 & 0xE6) == 0xE6 && ((r[1] >> 16) & 1) && ((r[1] >> 30) & 1);
+    return avx512 ? 3 : avx2 ? 2 : sse2 ? 1 : 0;
+}
+#   else
+static int zsimd_detect_(void)
+{
+    __builtin_cpu_init();
+#       ifdef ZSIMD_AVX512_
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return 3;
+    }
+#       endif
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return 2;
+    }
+    return __builtin_cpu_supports("sse2") ? 1 : 0;
+}
+#   endif
+
+#endif // ZSIMD_X86_
+
+typedef struct zsimd_table_ {
+    const char *(*memchr2)(const char *, size_t, char, char);
+    const char *(*memchr3)(const char *, size_t, char, char, char);
+    const char *(*memmem)(const char *, size_t, const char *, size_t);
+    size_t (*skip_space)(const char *, size_t);
+    size_t (*rskip_space)(const char *, size_t);
+    const char *name;
+} zsimd_table_;
+
+static const zsimd_table_ zsimd_scalar_table_ = {
+    zsimd_memchr2_scalar_, zsimd_memchr3_scalar_, zsimd_memmem_scalar_,
+    zsimd_skip_space_scalar_, zsimd_rskip_space_scalar_, "scalar"
+};
+
+#if ZSIMD_X86_
+static const zsimd_table_ zsimd_sse2_table_ = {
+    zsimd_memchr2_sse2_, zsimd_memchr3_sse2_, zsimd_memmem_sse2_,
+    zsimd_skip_space_sse2_, zsimd_rskip_space_sse2_, "sse2"
+};
+
+static const zsimd_table_ zsimd_avx2_table_ = {
+    zsimd_memchr2_avx2_, zsimd_memchr3_avx2_, zsimd_memmem_avx2_,
+    zsimd_skip_space_avx2_, zsimd_rskip_space_avx2_, "avx2"
+};
+
+#   ifdef ZSIMD_AVX512_
+// Trimming rarely scans far; the AVX2 kernels are kept for it.
+static const zsimd_table_ zsimd_avx512_table_ = {
+    zsimd_memchr2_avx512_, zsimd_memchr3_avx512_, zsimd_memmem_avx512_,
+    zsimd_skip_space_avx2_, zsimd_rskip_space_avx2_, "avx512"
+};
+#   endif
+#endif
+
+// Resolved once; concurrent first calls all store the same pointer to
+// constant data, so relaxed ordering is enough. Zero-initialised (NULL).
+static Z_ATOMIC(const zsimd_table_ *) zsimd_active_;
+
+static const zsimd_table_ *zsimd_table_get_(void)
+{
+    const zsimd_table_ *t = Z_ATOMIC_LOAD(&zsimd_active_, Z_MO_RELAXED);
+    if (Z_LIKELY(NULL != t))
+    {
+        return t;
+    }
+    t = &zsimd_scalar_table_;
+#if ZSIMD_X86_
+    switch (zsimd_detect_())
+    {
+#   ifdef ZSIMD_AVX512_
+        case 3: t = &zsimd_avx512_table_; break;
+#   else
+        case 3:
+#   endif
+        case 2: t = &zsimd_avx2_table_; break;
+        case 1: t = &zsimd_sse2_table_; break;
+        default: break;
+    }
+#endif
+    Z_ATOMIC_STORE(&zsimd_active_, t, Z_MO_RELAXED);
+    return t;
+}
+
+const char *z_memchr2(const char *s, size_t n, char a, char b)
+{
+    return zsimd_table_get_()->memchr2(s, n, a, b);
+}
+
+const char *z_memchr3(const char *s, size_t n, char a, char b, char c)
+{
+    return zsimd_table_get_()->memchr3(s, n, a, b, c);
+}
+
+const char *z_memmem(const char *hay, size_t n, const char *needle, size_t m)
+{
+    return zsimd_table_get_()->memmem(hay, n, needle, m);
+}
+
+size_t z_skip_space(const char *s, size_t n)
+{
+    return zsimd_table_get_()->skip_space(s, n);
+}
+
+size_t z_rskip_space(const char *s, size_t n)
+{
+    return zsimd_table_get_()->rskip_space(s, n);
+}
+
+const char *z_simd_isa(void)
+{
+    return zsimd_table_get_()->name;
+}
+
+#endif // ZSIMD_IMPLEMENTATION_DONE
+#endif // ZSIMD_IMPLEMENTATION
@@ -0,0 +1,308 @@
+/*
+ * zslab.h — Size-class slab allocator for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Serves small fixed-size blocks (list nodes, tree nodes, stable map
+ * entries) from contiguous slabs. Each thread keeps a free list per size
+ * class, so the hot path is a lock-free pop/push. Threads exchange blocks
+ * with a shared pool in batches of ZSLAB_BATCH, taking a short spin lock
+ * once per batch instead of once per node.
+ *
+ * Define ZSLAB_IMPLEMENTATION in exactly one translation unit before
+ * including this header.
+ *
+ * Notes:
+ * - Slabs are never returned to the system; the pool only grows.
+ * - Call z_slab_thread_flush() before a worker thread exits, otherwise the
+ *   blocks cached by that thread stay unusable by others.
+ * - Without thread-local storage (see Z_HAS_THREAD_LOCAL) the caches are
+ *   global and the allocator is only safe from a single thread.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZSLAB_H
+#define ZSLAB_H
+
+#include "zcommon.h"
+
+// Slab size. Must be a power of two; slabs are aligned to it.
+#ifndef ZSLAB_SLAB_SIZE
+#   define ZSLAB_SLAB_SIZE (64 * 1024)
+#endif
+
+// Slabs reserved per system allocation.
+#ifndef ZSLAB_REGION_SLABS
+#   define ZSLAB_REGION_SLABS 16
+#endif
+
+// Blocks moved between a thread cache and the shared pool at once.
+#ifndef ZSLAB_BATCH
+#   define ZSLAB_BATCH 32
+#endif
+
+// Size classes are multiples of ZSLAB_GRANULE up to ZSLAB_MAX_SIZE.
+#define ZSLAB_GRANULE  16
+#define ZSLAB_MAX_SIZE 256
+#define ZSLAB_CLASSES  (ZSLAB_MAX_SIZE / ZSLAB_GRANULE)
+
+// Where regions come from. Kept separate from Z_MALLOC so the slab can back it.
+#ifndef ZSLAB_REGION_MALLOC
+#   define ZSLAB_REGION_MALLOC(sz) malloc(sz)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* * Returns a block of at least `size` bytes (1..ZSLAB_MAX_SIZE),
+ * or NULL if `size` is out of range or memory is exhausted.
+ */
+void *z_slab_alloc(size_t size);
+
+// Releases a block from z_slab_alloc. The size class is found from the slab.
+void z_slab_free(void *ptr);
+
+// Hands every block cached by the calling thread back to the shared pool.
+void z_slab_thread_flush(void);
+
+/* * Adapter for containers taking a z_allocator. Requests above
+ * ZSLAB_MAX_SIZE fall through to the default allocator; this relies on
+ * the size passed to z_free, so release through z_free, not `->free`.
+ */
+z_allocator z_slab_allocator(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZSLAB_H
+
+#ifdef ZSLAB_IMPLEMENTATION
+#ifndef ZSLAB_IMPLEMENTATION_DONE
+#define ZSLAB_IMPLEMENTATION_DONE
+
+#include "zsync.h"
+
+// The shared pool is only locked once per batch, so a spin lock is enough.
+typedef z_spin zslab_lock_;
+#define ZSLAB_LOCK_(l)   z_spin_lock(&(l))
+#define ZSLAB_UNLOCK_(l) z_spin_unlock(&(l))
+
+// Slab header; objects start at ZSLAB_HEADER_SIZE so they stay cache-line aligned.
+#define ZSLAB_HEADER_SIZE 64
+
+typedef struct zslab_header_ {
+    size_t class_size;
+} zslab_header_;
+
+typedef struct zslab_node_ {
+    struct zslab_node_ *next;
+} zslab_node_;
+
+typedef struct zslab_class_ {
+    zslab_lock_ lock;
+    zslab_node_ *free_list;   // Blocks returned by threads.
+    char *bump;               // Uncarved part of the current slab.
+    char *bump_end;
+} zslab_class_;
+
+typedef struct zslab_cache_ {
+    zslab_node_ *head;
+    size_t count;
+} zslab_cache_;
+
+static struct {
+    zslab_lock_ lock;
+    char *next;               // Next unused slab in the current region.
+    char *end;
+    zslab_class_ classes[ZSLAB_CLASSES];
+} zslab_pool_;
+
+static Z_THREAD_LOCAL zslab_cache_ zslab_cache_tl_[ZSLAB_CLASSES];
+
+static inline size_t zslab_class_index_(size_t size)
+{
+    return (size - 1) / ZSLAB_GRANULE;
+}
+
+// Takes one fresh slab from the current region, opening a new region if needed.
+static char *zslab_new_slab_(size_t class_size)
+{
+    char *slab = NULL;
+    ZSLAB_LOCK_(zslab_pool_.lock);
+    if (zslab_pool_.next == zslab_pool_.end)
+    {
+        // One extra slab of slack so the region can be aligned to ZSLAB_SLAB_SIZE.
+        char *raw = (char *)ZSLAB_REGION_MALLOC((size_t)(ZSLAB_REGION_SLABS + 1) * ZSLAB_SLAB_SIZE);
+        if (raw)
+        {
+            uintptr_t a = ((uintptr_t)raw + ZSLAB_SLAB_SIZE - 1) & ~(uintptr_t)(ZSLAB_SLAB_SIZE - 1);
+            zslab_pool_.next = (char *)a;
+            zslab_pool_.end = (char *)a + (size_t)ZSLAB_REGION_SLABS * ZSLAB_SLAB_SIZE;
+        }
+    }
+    if (zslab_pool_.next != zslab_pool_.end)
+    {
+        slab = zslab_pool_.next;
+        zslab_pool_.next += ZSLAB_SLAB_SIZE;
+    }
+    ZSLAB_UNLOCK_(zslab_pool_.lock);
+    if (slab)
+    {
+        ((zslab_header_ *)slab)->class_size = class_size;
+    }
+    return slab;
+}
+
+// Moves up to ZSLAB_BATCH blocks from the shared pool into the thread cache.
+static bool zslab_refill_(size_t idx)
+{
+    Z_TRACE_SCOPE("z_slab_refill");
+    zslab_class_ *cls = &zslab_pool_.classes[idx];
+    zslab_cache_ *cache = &zslab_cache_tl_[idx];
+    size_t csize = (idx + 1) * ZSLAB_GRANULE;
+
+    ZSLAB_LOCK_(cls->lock);
+    while (cache->count < ZSLAB_BATCH)
+    {
+        zslab_node_ *n = cls->free_list;
+        if (n)
+        {
+            cls->free_list = n->next;
+        }
+        else
+        {
+            if ((size_t)(cls->bump_end - cls->bump) < csize)
+            {
+                char *slab = zslab_new_slab_(csize);
+                if (!slab)
+                {
+                    break;
+                }
+                cls->bump = slab + ZSLAB_HEADER_SIZE;
+                cls->bump_end = slab + ZSLAB_SLAB_SIZE;
+            }
+            n = (zslab_node_ *)cls->bump;
+            cls->bump += csize;
+        }
+        n->next = cache->head;
+        cache->head = n;
+        cache->count++;
+    }
+    ZSLAB_UNLOCK_(cls->lock);
+    return cache->count > 0;
+}
+
+// Returns `count` blocks from the front of the thread cache to the shared pool.
+static void zslab_drain_(size_t idx, size_t count)
+{
+    zslab_cache_ *cache = &zslab_cache_tl_[idx];
+    if (0 == count)
+    {
+        return;
+    }
+    // Detach the batch first so the lock only covers a splice.
+    zslab_node_ *first = cache->head;
+    zslab_node_ *last = first;
+    for (size_t i = 1; i < count; i++)
+    {
+        last = last->next;
+    }
+    cache->head = last->next;
+    cache->count -= count;
+
+    zslab_class_ *cls = &zslab_pool_.classes[idx];
+    ZSLAB_LOCK_(cls->lock);
+    last->next = cls->free_list;
+    cls->free_list = first;
+    ZSLAB_UNLOCK_(cls->lock);
+}
+
+void *z_slab_alloc(size_t size)
+{
+    if (Z_UNLIKELY(0 == size || size > ZSLAB_MAX_SIZE))
+    {
+        return NULL;
+    }
+    size_t idx = zslab_class_index_(size);
+    zslab_cache_ *cache = &zslab_cache_tl_[idx];
+    if (Z_UNLIKELY(!cache->head) && !zslab_refill_(idx))
+    {
+        return NULL;
+    }
+    zslab_node_ *n = cache->head;
+    cache->head = n->next;
+    cache->count--;
+    return n;
+}
+
+void z_slab_free(void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    zslab_header_ *h = (zslab_header_ *)((uintptr_t)ptr & ~(uintptr_t)(ZSLAB_SLAB_SIZE - 1));
+    size_t idx = zslab_class_index_(h->class_size);
+    zslab_cache_ *cache = &zslab_cache_tl_[idx];
+    zslab_node_ *n = (zslab_node_ *)ptr;
+    n->next = cache->head;
+    cache->head = n;
+    if (Z_UNLIKELY(++cache->count >= 2 * ZSLAB_BATCH))
+    {
+        zslab_drain_(idx, ZSLAB_BATCH);
+    }
+}
+
+void z_slab_thread_flush(void)
+{
+    for (size_t i = 0; i < ZSLAB_CLASSES; i++)
+    {
+        zslab_drain_(i, zslab_cache_tl_[i].count);
+    }
+}
+
+static void *zslab_cb_alloc_(void *ctx, size_t size)
+{
+    (void)ctx;
+    return (size <= ZSLAB_MAX_SIZE) ? z_slab_alloc(size ? size : 1) : z_alloc(NULL, size);
+}
+
+static void zslab_cb_free_(void *ctx, void *ptr)
+{
+    (void)ctx;
+    z_slab_free(ptr);
+}
+
+static void zslab_cb_sized_free_(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    if (size <= ZSLAB_MAX_SIZE)
+    {
+        z_slab_free(ptr);
+    }
+    else
+    {
+        z_free(NULL, ptr, size);
+    }
+}
+
+z_allocator z_slab_allocator(void)
+{
+    z_allocator al = {
+        NULL,
+        zslab_cb_alloc_,
+        NULL,
+        zslab_cb_free_,
+        zslab_cb_sized_free_,
+        NULL
+    };
+    return al;
+}
+
+#endif // ZSLAB_IMPLEMENTATION_DONE
+#endif // ZSLAB_IMPLEMENTATION
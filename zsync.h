@@ -0,0 +1,356 @@
+/*
+ * zsync.h — Spin locks and lock-free ring queues for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Built on the Z_ATOMIC layer in zcommon.h:
+ *
+ *   z_spin   Test-and-test-and-set lock with exponential backoff. For short
+ *            critical sections only; waiters yield the CPU after spinning.
+ *   z_spsc   Bounded single-producer/single-consumer queue. Each side keeps
+ *            a cached copy of the other side's index, so the common case
+ *            touches no shared cache line.
+ *   z_mpmc   Bounded multi-producer/multi-consumer queue (per-slot sequence
+ *            numbers, one CAS per operation, no ABA).
+ *
+ * Queues copy fixed-size elements by value, so a container struct can be
+ * handed to another thread as a whole. Capacity is rounded up to a power of
+ * two. Push returns Z_EFULL and pop returns Z_EEMPTY instead of blocking.
+ *
+ * Header-only: no implementation macro is needed.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZSYNC_H
+#define ZSYNC_H
+
+#include "zcommon.h"
+
+#if defined(_WIN32)
+#   include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#   include <sched.h>
+#endif
+
+// Backoff.
+
+// Rounds of doubling PAUSE bursts (1, 2, 4, ...) before yielding the CPU.
+#ifndef Z_BACKOFF_SPIN_ROUNDS
+#   define Z_BACKOFF_SPIN_ROUNDS 7
+#endif
+
+typedef struct z_backoff {
+    unsigned round;
+} z_backoff;
+
+#define Z_BACKOFF_INIT { 0 }
+
+static inline void z_thread_yield(void)
+{
+#if defined(_WIN32)
+    SwitchToThread();
+#elif defined(__unix__) || defined(__APPLE__)
+    sched_yield();
+#endif
+}
+
+static inline void z_backoff_pause(z_backoff *b)
+{
+    if (b->round < Z_BACKOFF_SPIN_ROUNDS)
+    {
+        for (unsigned i = 0; i < (1u << b->round); i++)
+        {
+            Z_CPU_RELAX();
+        }
+        b->round++;
+    }
+    else
+    {
+        z_thread_yield();
+    }
+}
+
+static inline void z_backoff_reset(z_backoff *b)
+{
+    b->round = 0;
+}
+
+// Spin lock.
+
+typedef struct z_spin {
+    Z_ATOMIC(int) locked;
+} z_spin;
+
+#ifdef __cplusplus
+#   define Z_SPIN_INIT { { 0 } }
+#else
+#   define Z_SPIN_INIT { 0 }
+#endif
+
+static inline void z_spin_init(z_spin *l)
+{
+    Z_ATOMIC_STORE(&l->locked, 0, Z_MO_RELAXED);
+}
+
+static inline bool z_spin_trylock(z_spin *l)
+{
+    int expected = 0;
+    return 0 == Z_ATOMIC_LOAD(&l->locked, Z_MO_RELAXED) &&
+           Z_ATOMIC_CAS(&l->locked, &expected, 1, Z_MO_ACQUIRE, Z_MO_RELAXED);
+}
+
+static inline void z_spin_lock(z_spin *l)
+{
+    if (Z_LIKELY(z_spin_trylock(l)))
+    {
+        return;
+    }
+    z_backoff b = Z_BACKOFF_INIT;
+    do
+    {
+        // Wait on a plain load so the line stays shared until the owner releases it.
+        while (0 != Z_ATOMIC_LOAD(&l->locked, Z_MO_RELAXED))
+        {
+            z_backoff_pause(&b);
+        }
+    } while (!z_spin_trylock(l));
+}
+
+static inline void z_spin_unlock(z_spin *l)
+{
+    Z_ATOMIC_STORE(&l->locked, 0, Z_MO_RELEASE);
+}
+
+// Shared helper: rounds a queue capacity up to a power of two (0 on overflow).
+static inline size_t zsync_pow2_(size_t n)
+{
+    size_t cap = 2;
+    while (cap < n)
+    {
+        if (cap > ((size_t)-1 >> 1))
+        {
+            return 0;
+        }
+        cap <<= 1;
+    }
+    return cap;
+}
+
+// Single-producer/single-consumer queue.
+
+typedef struct z_spsc {
+    // Read-only after init.
+    char *buf;
+    size_t mask;
+    size_t elem_size;
+    const z_allocator *alloc;
+    Z_CACHE_PAD(4 * sizeof(size_t));
+    // Consumer side.
+    Z_ATOMIC(size_t) head;
+    size_t tail_cache;
+    Z_CACHE_PAD(2 * sizeof(size_t));
+    // Producer side.
+    Z_ATOMIC(size_t) tail;
+    size_t head_cache;
+    Z_CACHE_PAD(2 * sizeof(size_t));
+} z_spsc;
+
+// `alloc` may be NULL for the default allocator.
+static inline int z_spsc_init(z_spsc *q, size_t capacity, size_t elem_size, const z_allocator *alloc)
+{
+    size_t cap = zsync_pow2_(capacity);
+    if (0 == cap || 0 == elem_size || cap > (size_t)-1 / elem_size)
+    {
+        return Z_EINVAL;
+    }
+    q->buf = (char *)z_alloc(alloc, cap * elem_size);
+    if (!q->buf)
+    {
+        return Z_ENOMEM;
+    }
+    q->mask = cap - 1;
+    q->elem_size = elem_size;
+    q->alloc = alloc;
+    Z_ATOMIC_STORE(&q->head, 0, Z_MO_RELAXED);
+    Z_ATOMIC_STORE(&q->tail, 0, Z_MO_RELAXED);
+    q->tail_cache = 0;
+    q->head_cache = 0;
+    return Z_OK;
+}
+
+static inline void z_spsc_free(z_spsc *q)
+{
+    z_free(q->alloc, q->buf, (q->mask + 1) * q->elem_size);
+    q->buf = NULL;
+}
+
+// Producer only. Copies `elem_size` bytes from `item`.
+static inline int z_spsc_push(z_spsc *q, const void *item)
+{
+    size_t tail = Z_ATOMIC_LOAD(&q->tail, Z_MO_RELAXED);
+    if (Z_UNLIKELY(tail - q->head_cache > q->mask))
+    {
+        q->head_cache = Z_ATOMIC_LOAD(&q->head, Z_MO_ACQUIRE);
+        if (tail - q->head_cache > q->mask)
+        {
+            return Z_EFULL;
+        }
+    }
+    memcpy(q->buf + (tail & q->mask) * q->elem_size, item, q->elem_size);
+    Z_ATOMIC_STORE(&q->tail, tail + 1, Z_MO_RELEASE);
+    return Z_OK;
+}
+
+// Consumer only. Copies the oldest element into `out`.
+static inline int z_spsc_pop(z_spsc *q, void *out)
+{
+    size_t head = Z_ATOMIC_LOAD(&q->head, Z_MO_RELAXED);
+    if (Z_UNLIKELY(head == q->tail_cache))
+    {
+        q->tail_cache = Z_ATOMIC_LOAD(&q->tail, Z_MO_ACQUIRE);
+        if (head == q->tail_cache)
+        {
+            return Z_EEMPTY;
+        }
+    }
+    memcpy(out, q->buf + (head & q->mask) * q->elem_size, q->elem_size);
+    Z_ATOMIC_STORE(&q->head, head + 1, Z_MO_RELEASE);
+    return Z_OK;
+}
+
+// Approximate while both sides are running.
+static inline size_t z_spsc_size(z_spsc *q)
+{
+    size_t tail = Z_ATOMIC_LOAD(&q->tail, Z_MO_ACQUIRE);
+    return tail - Z_ATOMIC_LOAD(&q->head, Z_MO_ACQUIRE);
+}
+
+// Multi-producer/multi-consumer queue.
+
+/* * Each cell is a sequence number followed by the element. A cell with
+ * seq == pos is free for the producer claiming `pos`; seq == pos + 1 holds
+ * data for the consumer claiming `pos`.
+ */
+typedef struct z_mpmc {
+    char *cells;
+    size_t mask;
+    size_t elem_size;
+    size_t stride;
+    const z_allocator *alloc;
+    Z_CACHE_PAD(5 * sizeof(size_t));
+    Z_ATOMIC(size_t) head;
+    Z_CACHE_PAD(sizeof(size_t));
+    Z_ATOMIC(size_t) tail;
+    Z_CACHE_PAD(sizeof(size_t));
+} z_mpmc;
+
+#define ZSYNC_SEQ_(q, pos) ((Z_ATOMIC(size_t) *)((q)->cells + ((pos) & (q)->mask) * (q)->stride))
+#define ZSYNC_DATA_OFFSET_ (((sizeof(size_t) + Z_MAX_ALIGN - 1) / Z_MAX_ALIGN) * Z_MAX_ALIGN)
+
+static inline int z_mpmc_init(z_mpmc *q, size_t capacity, size_t elem_size, const z_allocator *alloc)
+{
+    size_t cap = zsync_pow2_(capacity);
+    if (0 == cap || 0 == elem_size || elem_size > (size_t)-1 / 2)
+    {
+        return Z_EINVAL;
+    }
+    size_t stride = ((ZSYNC_DATA_OFFSET_ + elem_size + Z_MAX_ALIGN - 1) / Z_MAX_ALIGN) * Z_MAX_ALIGN;
+    if (cap > (size_t)-1 / stride)
+    {
+        return Z_EINVAL;
+    }
+    q->cells = (char *)z_alloc(alloc, cap * stride);
+    if (!q->cells)
+    {
+        return Z_ENOMEM;
+    }
+    q->mask = cap - 1;
+    q->elem_size = elem_size;
+    q->stride = stride;
+    q->alloc = alloc;
+    for (size_t i = 0; i < cap; i++)
+    {
+        Z_ATOMIC_STORE(ZSYNC_SEQ_(q, i), i, Z_MO_RELAXED);
+    }
+    Z_ATOMIC_STORE(&q->head, 0, Z_MO_RELAXED);
+    Z_ATOMIC_STORE(&q->tail, 0, Z_MO_RELAXED);
+    return Z_OK;
+}
+
+static inline void z_mpmc_free(z_mpmc *q)
+{
+    z_free(q->alloc, q->cells, (q->mask + 1) * q->stride);
+    q->cells = NULL;
+}
+
+static inline int z_mpmc_push(z_mpmc *q, const void *item)
+{
+    size_t pos = Z_ATOMIC_LOAD(&q->tail, Z_MO_RELAXED);
+    Z_ATOMIC(size_t) *seq;
+    for (;;)
+    {
+        seq = ZSYNC_SEQ_(q, pos);
+        intptr_t diff = (intptr_t)(Z_ATOMIC_LOAD(seq, Z_MO_ACQUIRE) - pos);
+        if (0 == diff)
+        {
+            if (Z_ATOMIC_CAS_WEAK(&q->tail, &pos, pos + 1, Z_MO_RELAXED, Z_MO_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return Z_EFULL;
+        }
+        else
+        {
+            pos = Z_ATOMIC_LOAD(&q->tail, Z_MO_RELAXED);
+        }
+    }
+    memcpy((char *)seq + ZSYNC_DATA_OFFSET_, item, q->elem_size);
+    Z_ATOMIC_STORE(seq, pos + 1, Z_MO_RELEASE);
+    return Z_OK;
+}
+
+static inline int z_mpmc_pop(z_mpmc *q, void *out)
+{
+    size_t pos = Z_ATOMIC_LOAD(&q->head, Z_MO_RELAXED);
+    Z_ATOMIC(size_t) *seq;
+    for (;;)
+    {
+        seq = ZSYNC_SEQ_(q, pos);
+        intptr_t diff = (intptr_t)(Z_ATOMIC_LOAD(seq, Z_MO_ACQUIRE) - (pos + 1));
+        if (0 == diff)
+        {
+            if (Z_ATOMIC_CAS_WEAK(&q->head, &pos, pos + 1, Z_MO_RELAXED, Z_MO_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return Z_EEMPTY;
+        }
+        else
+        {
+            pos = Z_ATOMIC_LOAD(&q->head, Z_MO_RELAXED);
+        }
+    }
+    memcpy(out, (char *)seq + ZSYNC_DATA_OFFSET_, q->elem_size);
+    // Free the cell for the producer one lap ahead.
+    Z_ATOMIC_STORE(seq, pos + q->mask + 1, Z_MO_RELEASE);
+    return Z_OK;
+}
+
+// Approximate while producers or consumers are running.
+static inline size_t z_mpmc_size(z_mpmc *q)
+{
+    size_t tail = Z_ATOMIC_LOAD(&q->tail, Z_MO_ACQUIRE);
+    size_t head = Z_ATOMIC_LOAD(&q->head, Z_MO_ACQUIRE);
+    return tail > head ? tail - head : 0;
+}
+
+#endif // ZSYNC_H
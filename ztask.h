@@ -0,0 +1,575 @@
+/*
+ * ztask.h — Work-stealing task scheduler for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * One process-wide scheduler with a fixed set of worker threads. Each
+ * worker owns a Chase-Lev deque: it pushes and pops its own tasks at the
+ * bottom (LIFO, cache-warm) while idle workers steal from the top (FIFO,
+ * the largest pieces of a recursive split). Threads that are not workers
+ * submit through a shared MPMC ring (zsync.h).
+ *
+ *   z_task_group g = Z_TASK_GROUP_INIT;
+ *   z_task_spawn(&g, build_left, &left);    // fork
+ *   build_right(&right);
+ *   z_task_wait(&g);                        // join (runs tasks while waiting)
+ *
+ *   z_parallel_for(0, n, 4096, sum_range, &acc);
+ *
+ * Task nodes come from the slab allocator, so spawning does not touch
+ * malloc. The scheduler starts lazily on first use with one worker per
+ * extra CPU; call z_sched_start to choose the count.
+ *
+ * Define ZTASK_IMPLEMENTATION in exactly one translation unit before
+ * including this header; that program must also compile zslab.h's
+ * implementation and link the platform threads library (-pthread).
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZTASK_H
+#define ZTASK_H
+
+#include "zcommon.h"
+
+typedef void (*z_task_fn)(void *ctx);
+typedef void (*z_range_fn)(void *ctx, size_t begin, size_t end);
+
+// Counts unfinished tasks spawned into it. Must outlive its z_task_wait.
+typedef struct z_task_group {
+    Z_ATOMIC(size_t) pending;
+} z_task_group;
+
+#ifdef __cplusplus
+#   define Z_TASK_GROUP_INIT { { 0 } }
+#else
+#   define Z_TASK_GROUP_INIT { 0 }
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* * Starts `workers` threads (0 = one per CPU beyond the caller's).
+ * Returns Z_OK, Z_EEXIST if already running, or Z_ENOMEM.
+ */
+int z_sched_start(size_t workers);
+
+// Joins all workers. Every group must have been waited on first.
+void z_sched_stop(void);
+
+// Worker threads currently running (starting the scheduler if needed).
+size_t z_sched_workers(void);
+
+// Queues fn(ctx) as part of `g`. Runs it immediately if the queue is full
+// or the scheduler could not start.
+void z_task_spawn(z_task_group *g, z_task_fn fn, void *ctx);
+
+// Returns once every task spawned into `g` has finished, running tasks meanwhile.
+void z_task_wait(z_task_group *g);
+
+/* * Calls fn(ctx, lo, hi) over disjoint subranges covering [begin, end),
+ * each at most `grain` long (0 = split into ~8 pieces per thread), and
+ * returns when all of them are done.
+ */
+void z_parallel_for(size_t begin, size_t end, size_t grain, z_range_fn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZTASK_H
+
+#ifdef ZTASK_IMPLEMENTATION
+#ifndef ZTASK_IMPLEMENTATION_DONE
+#define ZTASK_IMPLEMENTATION_DONE
+
+#include "zslab.h"
+#include "zsync.h"
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+
+// Tasks each worker deque holds (power of two). Overflow runs inline.
+#ifndef ZTASK_DEQUE_SIZE
+#   define ZTASK_DEQUE_SIZE 4096
+#endif
+
+// Slots in the ring used by threads that are not workers.
+#ifndef ZTASK_INJECT_SIZE
+#   define ZTASK_INJECT_SIZE 4096
+#endif
+
+#ifndef ZTASK_MAX_WORKERS
+#   define ZTASK_MAX_WORKERS 256
+#endif
+
+#if defined(_WIN32)
+typedef HANDLE ztask_thread_;
+typedef SRWLOCK ztask_mutex_;
+typedef CONDITION_VARIABLE ztask_cond_;
+#   define ZTASK_MUTEX_INIT_(m)  InitializeSRWLock(m)
+#   define ZTASK_MUTEX_LOCK_(m)  AcquireSRWLockExclusive(m)
+#   define ZTASK_MUTEX_UNLOCK_(m) ReleaseSRWLockExclusive(m)
+#   define ZTASK_COND_INIT_(c)   InitializeConditionVariable(c)
+#   define ZTASK_COND_WAIT_(c, m) SleepConditionVariableSRW(c, m, INFINITE, 0)
+#   define ZTASK_COND_SIGNAL_(c) WakeConditionVariable(c)
+#   define ZTASK_COND_BROADCAST_(c) WakeAllConditionVariable(c)
+    // SRW locks and condition variables hold no resources.
+#   define ZTASK_MUTEX_DESTROY_(m) ((void)(m))
+#   define ZTASK_COND_DESTROY_(c) ((void)(c))
+#else
+typedef pthread_t ztask_thread_;
+typedef pthread_mutex_t ztask_mutex_;
+typedef pthread_cond_t ztask_cond_;
+#   define ZTASK_MUTEX_INIT_(m)  pthread_mutex_init(m, NULL)
+#   define ZTASK_MUTEX_LOCK_(m)  pthread_mutex_lock(m)
+#   define ZTASK_MUTEX_UNLOCK_(m) pthread_mutex_unlock(m)
+#   define ZTASK_COND_INIT_(c)   pthread_cond_init(c, NULL)
+#   define ZTASK_COND_WAIT_(c, m) pthread_cond_wait(c, m)
+#   define ZTASK_COND_SIGNAL_(c) pthread_cond_signal(c)
+#   define ZTASK_COND_BROADCAST_(c) pthread_cond_broadcast(c)
+#   define ZTASK_MUTEX_DESTROY_(m) pthread_mutex_destroy(m)
+#   define ZTASK_COND_DESTROY_(c) pthread_cond_destroy(c)
+#endif
+
+typedef struct ztask_node_ {
+    z_task_fn fn;
+    void *ctx;
+    z_task_group *group;
+} ztask_node_;
+
+// Chase-Lev deque with a fixed ring: the owner works the bottom, thieves the top.
+typedef struct ztask_worker_ {
+    Z_ATOMIC(int64_t) top;
+    Z_CACHE_PAD(sizeof(int64_t));
+    Z_ATOMIC(int64_t) bottom;
+    Z_CACHE_PAD(sizeof(int64_t));
+    Z_ATOMIC(ztask_node_ *) ring[ZTASK_DEQUE_SIZE];
+    ztask_thread_ thread;
+    uint64_t rng;
+} ztask_worker_;
+
+static struct {
+    ztask_worker_ *workers;
+    size_t count;                   // Deques (fixed while running).
+    size_t started;                 // Threads actually running.
+    z_mpmc inject;
+    Z_ATOMIC(int) running;
+    Z_ATOMIC(int) failed;           // Last start ran out of memory; spawns run inline.
+    Z_ATOMIC(int) stop;
+    Z_ATOMIC(unsigned) epoch;       // Bumped on every spawn; sleepers wait for a change.
+    Z_ATOMIC(int) sleepers;
+    ztask_mutex_ mutex;
+    ztask_cond_ cond;
+    z_spin start_lock;
+} ztask_;
+
+static Z_THREAD_LOCAL ztask_worker_ *ztask_self_ = NULL;
+
+static bool ztask_push_(ztask_worker_ *w, ztask_node_ *n)
+{
+    int64_t b = Z_ATOMIC_LOAD(&w->bottom, Z_MO_RELAXED);
+    int64_t t = Z_ATOMIC_LOAD(&w->top, Z_MO_ACQUIRE);
+    if (b - t >= ZTASK_DEQUE_SIZE)
+    {
+        return false;
+    }
+    Z_ATOMIC_STORE(&w->ring[b & (ZTASK_DEQUE_SIZE - 1)], n, Z_MO_RELAXED);
+    Z_ATOMIC_STORE(&w->bottom, b + 1, Z_MO_RELEASE);
+    return true;
+}
+
+static ztask_node_ *ztask_pop_(ztask_worker_ *w)
+{
+    int64_t b = Z_ATOMIC_LOAD(&w->bottom, Z_MO_RELAXED) - 1;
+    Z_ATOMIC_STORE(&w->bottom, b, Z_MO_SEQ_CST);
+    int64_t t = Z_ATOMIC_LOAD(&w->top, Z_MO_SEQ_CST);
+    if (t > b)
+    {
+        Z_ATOMIC_STORE(&w->bottom, b + 1, Z_MO_RELAXED);
+        return NULL;
+    }
+    ztask_node_ *n = Z_ATOMIC_LOAD(&w->ring[b & (ZTASK_DEQUE_SIZE - 1)], Z_MO_RELAXED);
+    if (t == b)
+    {
+        // Last task: race any thief for it through `top`.
+        if (!Z_ATOMIC_CAS(&w->top, &t, t + 1, Z_MO_SEQ_CST, Z_MO_RELAXED))
+        {
+            n = NULL;
+        }
+        Z_ATOMIC_STORE(&w->bottom, b + 1, Z_MO_RELAXED);
+    }
+    return n;
+}
+
+static ztask_node_ *ztask_steal_(ztask_worker_ *w)
+{
+    int64_t t = Z_ATOMIC_LOAD(&w->top, Z_MO_SEQ_CST);
+    int64_t b = Z_ATOMIC_LOAD(&w->bottom, Z_MO_SEQ_CST);
+    if (t >= b)
+    {
+        return NULL;
+    }
+    ztask_node_ *n = Z_ATOMIC_LOAD(&w->ring[t & (ZTASK_DEQUE_SIZE - 1)], Z_MO_RELAXED);
+    if (!Z_ATOMIC_CAS(&w->top, &t, t + 1, Z_MO_SEQ_CST, Z_MO_RELAXED))
+    {
+        return NULL;
+    }
+    return n;
+}
+
+// Own deque first, then the shared ring, then a sweep of the other workers.
+static ztask_node_ *ztask_find_(ztask_worker_ *self)
+{
+    ztask_node_ *n = NULL;
+    if (self && NULL != (n = ztask_pop_(self)))
+    {
+        return n;
+    }
+    if (Z_OK == z_mpmc_pop(&ztask_.inject, &n))
+    {
+        return n;
+    }
+    size_t count = ztask_.count;
+    if (0 == count)
+    {
+        return NULL;
+    }
+    size_t start = 0;
+    if (self)
+    {
+        self->rng ^= self->rng << 13;
+        self->rng ^= self->rng >> 7;
+        self->rng ^= self->rng << 17;
+        start = (size_t)(self->rng % count);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        ztask_worker_ *victim = &ztask_.workers[(start + i) % count];
+        if (victim != self && NULL != (n = ztask_steal_(victim)))
+        {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+static void ztask_run_(ztask_node_ *n)
+{
+    z_task_group *g = n->group;
+    n->fn(n->ctx);
+    z_slab_free(n);
+    Z_ATOMIC_FETCH_SUB(&g->pending, 1, Z_MO_RELEASE);
+}
+
+static void ztask_notify_(void)
+{
+    Z_ATOMIC_FETCH_ADD(&ztask_.epoch, 1u, Z_MO_SEQ_CST);
+    if (Z_ATOMIC_LOAD(&ztask_.sleepers, Z_MO_SEQ_CST) > 0)
+    {
+        ZTASK_MUTEX_LOCK_(&ztask_.mutex);
+        ZTASK_COND_SIGNAL_(&ztask_.cond);
+        ZTASK_MUTEX_UNLOCK_(&ztask_.mutex);
+    }
+}
+
+static void ztask_worker_loop_(ztask_worker_ *self)
+{
+    ztask_self_ = self;
+    z_backoff b = Z_BACKOFF_INIT;
+    for (;;)
+    {
+        ztask_node_ *n = ztask_find_(self);
+        if (n)
+        {
+            ztask_run_(n);
+            z_backoff_reset(&b);
+            continue;
+        }
+        if (Z_ATOMIC_LOAD(&ztask_.stop, Z_MO_ACQUIRE))
+        {
+            break;
+        }
+        if (b.round < Z_BACKOFF_SPIN_ROUNDS)
+        {
+            z_backoff_pause(&b);
+            continue;
+        }
+        // Announce the sleep, then look once more so no spawn is missed.
+        unsigned epoch = Z_ATOMIC_LOAD(&ztask_.epoch, Z_MO_SEQ_CST);
+        Z_ATOMIC_FETCH_ADD(&ztask_.sleepers, 1, Z_MO_SEQ_CST);
+        n = ztask_find_(self);
+        if (!n)
+        {
+            ZTASK_MUTEX_LOCK_(&ztask_.mutex);
+            while (epoch == Z_ATOMIC_LOAD(&ztask_.epoch, Z_MO_SEQ_CST) &&
+                   !Z_ATOMIC_LOAD(&ztask_.stop, Z_MO_ACQUIRE))
+            {
+                ZTASK_COND_WAIT_(&ztask_.cond, &ztask_.mutex);
+            }
+            ZTASK_MUTEX_UNLOCK_(&ztask_.mutex);
+        }
+        Z_ATOMIC_FETCH_SUB(&ztask_.sleepers, 1, Z_MO_SEQ_CST);
+        z_backoff_reset(&b);
+        if (n)
+        {
+            ztask_run_(n);
+        }
+    }
+    z_slab_thread_flush();
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI ztask_thread_main_(LPVOID arg)
+{
+    ztask_worker_loop_((ztask_worker_ *)arg);
+    return 0;
+}
+#else
+static void *ztask_thread_main_(void *arg)
+{
+    ztask_worker_loop_((ztask_worker_ *)arg);
+    return NULL;
+}
+#endif
+
+static size_t ztask_cpu_count_(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (size_t)si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+static int ztask_start_locked_(size_t workers)
+{
+    if (0 == workers)
+    {
+        workers = ztask_cpu_count_() - 1;
+    }
+    if (workers > ZTASK_MAX_WORKERS)
+    {
+        workers = ZTASK_MAX_WORKERS;
+    }
+    if (Z_OK != z_mpmc_init(&ztask_.inject, ZTASK_INJECT_SIZE, sizeof(ztask_node_ *), NULL))
+    {
+        Z_ATOMIC_STORE(&ztask_.failed, 1, Z_MO_RELAXED);
+        return Z_ENOMEM;
+    }
+    if (workers)
+    {
+        ztask_.workers = (ztask_worker_ *)calloc(workers, sizeof(ztask_worker_));
+        if (!ztask_.workers)
+        {
+            z_mpmc_free(&ztask_.inject);
+            Z_ATOMIC_STORE(&ztask_.failed, 1, Z_MO_RELAXED);
+            return Z_ENOMEM;
+        }
+    }
+    Z_ATOMIC_STORE(&ztask_.failed, 0, Z_MO_RELAXED);
+    ZTASK_MUTEX_INIT_(&ztask_.mutex);
+    ZTASK_COND_INIT_(&ztask_.cond);
+    Z_ATOMIC_STORE(&ztask_.stop, 0, Z_MO_RELAXED);
+    // A deque whose thread failed to start just stays empty.
+    ztask_.count = workers;
+    size_t started = 0;
+    for (; started < workers; started++)
+    {
+        ztask_worker_ *w = &ztask_.workers[started];
+        w->rng = 0x9E3779B97F4A7C15ull * (started + 1);
+#if defined(_WIN32)
+        w->thread = CreateThread(NULL, 0, ztask_thread_main_, w, 0, NULL);
+        if (!w->thread)
+        {
+            break;
+        }
+#else
+        if (0 != pthread_create(&w->thread, NULL, ztask_thread_main_, w))
+        {
+            break;
+        }
+#endif
+    }
+    ztask_.started = started;
+    Z_ATOMIC_STORE(&ztask_.running, 1, Z_MO_RELEASE);
+    return Z_OK;
+}
+
+int z_sched_start(size_t workers)
+{
+    z_spin_lock(&ztask_.start_lock);
+    int rc = Z_ATOMIC_LOAD(&ztask_.running, Z_MO_ACQUIRE) ? Z_EEXIST : ztask_start_locked_(workers);
+    z_spin_unlock(&ztask_.start_lock);
+    return rc;
+}
+
+// False if the scheduler could not start. A failed implicit start is not
+// retried; an explicit z_sched_start() clears it.
+static bool ztask_ensure_started_(void)
+{
+    if (Z_LIKELY(Z_ATOMIC_LOAD(&ztask_.running, Z_MO_ACQUIRE)))
+    {
+        return true;
+    }
+    if (Z_ATOMIC_LOAD(&ztask_.failed, Z_MO_RELAXED))
+    {
+        return false;
+    }
+    return Z_ENOMEM != z_sched_start(0);
+}
+
+void z_sched_stop(void)
+{
+    z_spin_lock(&ztask_.start_lock);
+    if (Z_ATOMIC_LOAD(&ztask_.running, Z_MO_ACQUIRE))
+    {
+        ZTASK_MUTEX_LOCK_(&ztask_.mutex);
+        Z_ATOMIC_STORE(&ztask_.stop, 1, Z_MO_RELEASE);
+        ZTASK_COND_BROADCAST_(&ztask_.cond);
+        ZTASK_MUTEX_UNLOCK_(&ztask_.mutex);
+        for (size_t i = 0; i < ztask_.started; i++)
+        {
+#if defined(_WIN32)
+            WaitForSingleObject(ztask_.workers[i].thread, INFINITE);
+            CloseHandle(ztask_.workers[i].thread);
+#else
+            pthread_join(ztask_.workers[i].thread, NULL);
+#endif
+        }
+        // No worker can touch them now; the next start initialises them again.
+        ZTASK_COND_DESTROY_(&ztask_.cond);
+        ZTASK_MUTEX_DESTROY_(&ztask_.mutex);
+        free(ztask_.workers);
+        ztask_.workers = NULL;
+        ztask_.count = 0;
+        ztask_.started = 0;
+        z_mpmc_free(&ztask_.inject);
+        Z_ATOMIC_STORE(&ztask_.running, 0, Z_MO_RELEASE);
+    }
+    z_spin_unlock(&ztask_.start_lock);
+}
+
+size_t z_sched_workers(void)
+{
+    ztask_ensure_started_();
+    return ztask_.started;
+}
+
+void z_task_spawn(z_task_group *g, z_task_fn fn, void *ctx)
+{
+    if (Z_UNLIKELY(!ztask_ensure_started_()))
+    {
+        fn(ctx);
+        return;
+    }
+    ztask_node_ *n = (ztask_node_ *)z_slab_alloc(sizeof(ztask_node_));
+    if (!n)
+    {
+        fn(ctx);
+        return;
+    }
+    n->fn = fn;
+    n->ctx = ctx;
+    n->group = g;
+    Z_ATOMIC_FETCH_ADD(&g->pending, 1, Z_MO_RELAXED);
+    ztask_worker_ *self = ztask_self_;
+    bool queued = self ? ztask_push_(self, n) : (Z_OK == z_mpmc_push(&ztask_.inject, &n));
+    if (!queued)
+    {
+        ztask_run_(n);
+        return;
+    }
+    ztask_notify_();
+}
+
+void z_task_wait(z_task_group *g)
+{
+    ztask_worker_ *self = ztask_self_;
+    z_backoff b = Z_BACKOFF_INIT;
+    while (0 != Z_ATOMIC_LOAD(&g->pending, Z_MO_ACQUIRE))
+    {
+        ztask_node_ *n = ztask_find_(self);
+        if (n)
+        {
+            ztask_run_(n);
+            z_backoff_reset(&b);
+        }
+        else
+        {
+            z_backoff_pause(&b);
+        }
+    }
+}
+
+typedef struct ztask_range_ {
+    z_range_fn fn;
+    void *ctx;
+    z_task_group *group;
+    size_t grain;
+    size_t begin;
+    size_t end;
+} ztask_range_;
+
+static void ztask_split_(z_range_fn fn, void *ctx, z_task_group *g, size_t grain, size_t begin, size_t end);
+
+static void ztask_range_task_(void *arg)
+{
+    ztask_range_ r = *(ztask_range_ *)arg;
+    z_slab_free(arg);
+    ztask_split_(r.fn, r.ctx, r.group, r.grain, r.begin, r.end);
+}
+
+// Hands off the upper half until the remainder fits in one grain.
+static void ztask_split_(z_range_fn fn, void *ctx, z_task_group *g, size_t grain, size_t begin, size_t end)
+{
+    while (end - begin > grain)
+    {
+        size_t mid = begin + (end - begin) / 2;
+        ztask_range_ *r = (ztask_range_ *)z_slab_alloc(sizeof(ztask_range_));
+        if (!r)
+        {
+            break;
+        }
+        r->fn = fn;
+        r->ctx = ctx;
+        r->group = g;
+        r->grain = grain;
+        r->begin = mid;
+        r->end = end;
+        z_task_spawn(g, ztask_range_task_, r);
+        end = mid;
+    }
+    fn(ctx, begin, end);
+}
+
+void z_parallel_for(size_t begin, size_t end, size_t grain, z_range_fn fn, void *ctx)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    if (0 == grain)
+    {
+        size_t pieces = (z_sched_workers() + 1) * 8;
+        grain = (end - begin + pieces - 1) / pieces;
+    }
+    z_task_group g = Z_TASK_GROUP_INIT;
+    ztask_split_(fn, ctx, &g, grain, begin, end);
+    z_task_wait(&g);
+}
+
+#endif // ZTASK_IMPLEMENTATION_DONE
+#endif // ZTASK_IMPLEMENTATION
@@ -0,0 +1,347 @@
+/*
+ * ztrace.h — Scoped tracing spans for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Compile everything with -DZ_TRACE and Z_TRACE_SCOPE("name") (from
+ * zcommon.h) records one complete event per scope: start time and duration.
+ * Each thread writes into its own ring of ZTRACE_RING_EVENTS events with no
+ * locks and no allocation after the first span; when the ring wraps the
+ * oldest spans are overwritten.
+ *
+ * The trace is written as Chrome trace JSON (chrome://tracing, Perfetto UI)
+ * at exit, to the file named by z_trace_set_output, $Z_TRACE_FILE or
+ * Z_TRACE_DEFAULT_FILE, in that order. z_trace_dump writes it on demand and
+ * may run while other threads keep tracing.
+ *
+ * Define ZTRACE_IMPLEMENTATION in exactly one translation unit before
+ * including this header. Without Z_TRACE the API still links but the trace
+ * is empty, so call sites need no #ifdefs.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZTRACE_H
+#define ZTRACE_H
+
+#include "zcommon.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Entry points used by Z_TRACE_SCOPE under Z_TRACE.
+z_trace_span_ z_trace_begin_(const char *name);
+void z_trace_end_(z_trace_span_ *span);
+
+// Labels the calling thread in the trace viewer. `name` is not copied.
+void z_trace_thread_name(const char *name);
+
+/* * Sets the file written at exit (NULL disables the exit dump).
+ * `path` is not copied.
+ */
+void z_trace_set_output(const char *path);
+
+// Writes every thread's spans as Chrome trace JSON. Returns Z_OK or Z_ERR.
+int z_trace_write(FILE *f);
+int z_trace_dump(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZTRACE_H
+
+#ifdef ZTRACE_IMPLEMENTATION
+#ifndef ZTRACE_IMPLEMENTATION_DONE
+#define ZTRACE_IMPLEMENTATION_DONE
+
+#include <time.h>
+#if defined(_WIN32)
+#   include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#   include <unistd.h>
+#endif
+
+// Events kept per thread (power of two).
+#ifndef ZTRACE_RING_EVENTS
+#   define ZTRACE_RING_EVENTS 16384
+#endif
+
+#ifndef Z_TRACE_DEFAULT_FILE
+#   define Z_TRACE_DEFAULT_FILE "ztrace.json"
+#endif
+
+/* * The ring has a single writer: it fills a slot, then publishes the new
+ * head with a release store. Readers copy slots and re-check the head to
+ * drop any slot the writer may have been overwriting meanwhile. As in a
+ * seqlock writer, a release fence ahead of the slot stores ensures a reader
+ * that sees a rewritten slot also sees the head it was rewritten after.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#   define ZTRACE_LOAD_(x)      __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#   define ZTRACE_STORE_(x, v)  __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#   define ZTRACE_ACQUIRE_(x)   __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#   define ZTRACE_PUBLISH_(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#   define ZTRACE_FENCE_()      __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+    // No atomics available: dumps are only exact while other threads are idle.
+#   define ZTRACE_LOAD_(x)      (x)
+#   define ZTRACE_STORE_(x, v)  ((x) = (v))
+#   define ZTRACE_ACQUIRE_(x)   (x)
+#   define ZTRACE_PUBLISH_(x, v) ((x) = (v))
+#   define ZTRACE_FENCE_()      ((void)0)
+#endif
+
+typedef struct ztrace_event_ {
+    const char *name;
+    uint64_t start;
+    uint64_t dur;
+} ztrace_event_;
+
+typedef struct ztrace_thread_ {
+    struct ztrace_thread_ *next;
+    const char *name;
+    uint64_t tid;
+    uint64_t head;                  // Events ever written; slot = head % ring.
+    ztrace_event_ ring[ZTRACE_RING_EVENTS];
+} ztrace_thread_;
+
+static ztrace_thread_ *ztrace_threads_ = NULL;
+static uint64_t ztrace_next_tid_ = 0;
+static int ztrace_atexit_ = 0;
+static const char *ztrace_output_ = NULL;
+static int ztrace_output_set_ = 0;
+static Z_THREAD_LOCAL ztrace_thread_ *ztrace_self_ = NULL;
+
+static uint64_t ztrace_now_ns_(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (0 == freq.QuadPart)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)((double)clock() * (1e9 / CLOCKS_PER_SEC));
+#endif
+}
+
+static void ztrace_at_exit_(void)
+{
+    const char *path = ztrace_output_set_ ? ztrace_output_ : getenv("Z_TRACE_FILE");
+    if (!ztrace_output_set_ && !path)
+    {
+        path = Z_TRACE_DEFAULT_FILE;
+    }
+    if (path)
+    {
+        z_trace_dump(path);
+    }
+}
+
+static ztrace_thread_ *ztrace_self_get_(void)
+{
+    ztrace_thread_ *t = ztrace_self_;
+    if (Z_LIKELY(NULL != t))
+    {
+        return t;
+    }
+    t = (ztrace_thread_ *)malloc(sizeof(ztrace_thread_));
+    if (!t)
+    {
+        return NULL;
+    }
+    t->name = NULL;
+    t->head = 0;
+    // Thread records are never freed so their spans survive thread exit.
+#if defined(__GNUC__) || defined(__clang__)
+    t->tid = __atomic_add_fetch(&ztrace_next_tid_, 1, __ATOMIC_RELAXED);
+    if (0 == __atomic_exchange_n(&ztrace_atexit_, 1, __ATOMIC_RELAXED))
+    {
+        atexit(ztrace_at_exit_);
+    }
+    t->next = __atomic_load_n(&ztrace_threads_, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ztrace_threads_, &t->next, t, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+#else
+    t->tid = ++ztrace_next_tid_;
+    if (!ztrace_atexit_)
+    {
+        ztrace_atexit_ = 1;
+        atexit(ztrace_at_exit_);
+    }
+    t->next = ztrace_threads_;
+    ztrace_threads_ = t;
+#endif
+    ztrace_self_ = t;
+    return t;
+}
+
+z_trace_span_ z_trace_begin_(const char *name)
+{
+    z_trace_span_ span;
+    span.name = name;
+    span.start = ztrace_now_ns_();
+    return span;
+}
+
+void z_trace_end_(z_trace_span_ *span)
+{
+    uint64_t end = ztrace_now_ns_();
+    ztrace_thread_ *t = ztrace_self_get_();
+    if (Z_UNLIKELY(!t))
+    {
+        return;
+    }
+    uint64_t h = t->head;
+    ztrace_event_ *e = &t->ring[h & (ZTRACE_RING_EVENTS - 1)];
+    ZTRACE_FENCE_();
+    ZTRACE_STORE_(e->name, span->name);
+    ZTRACE_STORE_(e->start, span->start);
+    ZTRACE_STORE_(e->dur, end - span->start);
+    ZTRACE_PUBLISH_(t->head, h + 1);
+}
+
+void z_trace_thread_name(const char *name)
+{
+    ztrace_thread_ *t = ztrace_self_get_();
+    if (t)
+    {
+        ZTRACE_STORE_(t->name, name);
+    }
+}
+
+void z_trace_set_output(const char *path)
+{
+    ztrace_output_ = path;
+    ztrace_output_set_ = 1;
+}
+
+static void ztrace_write_string_(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; s && *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if ('"' == c || '\\' == c)
+        {
+            fputc('\\', f);
+            fputc(c, f);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(f, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static unsigned long ztrace_pid_(void)
+{
+#if defined(_WIN32)
+    return (unsigned long)GetCurrentProcessId();
+#elif defined(__unix__) || defined(__APPLE__)
+    return (unsigned long)getpid();
+#else
+    return 1;
+#endif
+}
+
+int z_trace_write(FILE *f)
+{
+    ztrace_event_ *copy = (ztrace_event_ *)malloc(sizeof(ztrace_event_) * ZTRACE_RING_EVENTS);
+    if (!copy)
+    {
+        return Z_ERR;
+    }
+    unsigned long pid = ztrace_pid_();
+    bool first = true;
+    fputs("{\"traceEvents\":[\n", f);
+
+    for (ztrace_thread_ *t = ZTRACE_ACQUIRE_(ztrace_threads_); t; t = t->next)
+    {
+        const char *tname = ZTRACE_LOAD_(t->name);
+        if (tname)
+        {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%llu,\"args\":{\"name\":",
+                    first ? "" : ",\n", pid, (unsigned long long)t->tid);
+            ztrace_write_string_(f, tname);
+            fputs("}}", f);
+            first = false;
+        }
+
+        uint64_t head = ZTRACE_ACQUIRE_(t->head);
+        uint64_t base = head > ZTRACE_RING_EVENTS ? head - ZTRACE_RING_EVENTS : 0;
+        for (uint64_t i = base; i < head; i++)
+        {
+            const ztrace_event_ *e = &t->ring[i & (ZTRACE_RING_EVENTS - 1)];
+            ztrace_event_ *c = &copy[i - base];
+            // Acquire loads keep the head re-check below after the copy.
+            c->name = ZTRACE_ACQUIRE_(e->name);
+            c->start = ZTRACE_ACQUIRE_(e->start);
+            c->dur = ZTRACE_ACQUIRE_(e->dur);
+        }
+        // The writer of event `now` may have been rewriting event `now - ring`.
+        uint64_t now = ZTRACE_LOAD_(t->head);
+        uint64_t from = base;
+        if (now >= ZTRACE_RING_EVENTS && now - ZTRACE_RING_EVENTS + 1 > from)
+        {
+            from = now - ZTRACE_RING_EVENTS + 1;
+        }
+
+        for (uint64_t i = from; i < head; i++)
+        {
+            const ztrace_event_ *c = &copy[i - base];
+            fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+            ztrace_write_string_(f, c->name);
+            fprintf(f, ",\"ph\":\"X\",\"pid\":%lu,\"tid\":%llu,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+                    pid, (unsigned long long)t->tid,
+                    (unsigned long long)(c->start / 1000), (unsigned)(c->start % 1000),
+                    (unsigned long long)(c->dur / 1000), (unsigned)(c->dur % 1000));
+            first = false;
+        }
+    }
+
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", f);
+    free(copy);
+    return ferror(f) ? Z_ERR : Z_OK;
+}
+
+int z_trace_dump(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        return Z_ERR;
+    }
+    int rc = z_trace_write(f);
+    if (0 != fclose(f))
+    {
+        rc = Z_ERR;
+    }
+    return rc;
+}
+
+#endif // ZTRACE_IMPLEMENTATION_DONE
+#endif // ZTRACE_IMPLEMENTATION
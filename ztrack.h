@@ -0,0 +1,524 @@
+/*
+ * ztrack.h — Allocation instrumentation for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * Compile everything with -DZ_TRACK_ALLOC and zcommon.h routes the Z_MALLOC
+ * family through this module. Each block carries a small header recording
+ * its size and call site. Counters are kept per thread and merged only when
+ * a snapshot or report is requested; only live/peak bytes are global.
+ *
+ * Define ZTRACK_IMPLEMENTATION in exactly one translation unit before
+ * including this header. Without Z_TRACK_ALLOC the API still links but
+ * reports zeroes, so call sites need no #ifdefs.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZTRACK_H
+#define ZTRACK_H
+
+#include "zcommon.h"
+#include <stdio.h>
+
+// Size histogram: bucket 0 holds zero-byte requests, bucket i holds [2^(i-1), 2^i).
+#define Z_TRACK_BUCKETS 48
+
+typedef struct z_track_stats {
+    uint64_t allocs;            // Z_MALLOC + Z_CALLOC (and Z_REALLOC of NULL).
+    uint64_t reallocs;
+    uint64_t frees;
+    uint64_t bytes_requested;   // Cumulative, including realloc targets.
+    int64_t  live_bytes;
+    int64_t  peak_bytes;        // Process-wide high-water mark.
+    uint64_t histogram[Z_TRACK_BUCKETS];
+} z_track_stats;
+
+typedef struct z_track_site {
+    const char *file;
+    int line;
+    uint64_t allocs;
+    uint64_t reallocs;
+    uint64_t frees;             // Frees of blocks last (re)allocated here.
+    uint64_t bytes_requested;
+    int64_t  live_bytes;
+} z_track_site;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Entry points used by the Z_MALLOC family under Z_TRACK_ALLOC.
+void *z_track_malloc(size_t size, const char *file, int line);
+void *z_track_calloc(size_t n, size_t size, const char *file, int line);
+void *z_track_realloc(void *ptr, size_t size, const char *file, int line);
+void  z_track_free(void *ptr, const char *file, int line);
+
+// Merges all per-thread counters into `out`.
+void z_track_snapshot(z_track_stats *out);
+
+// `out = after - before`. Peak is taken from `after`.
+void z_track_diff(const z_track_stats *before, const z_track_stats *after, z_track_stats *out);
+
+/* * Merges call-site records across threads, sorted by live bytes (desc).
+ * Copies at most `cap` entries and returns the total number of sites.
+ */
+size_t z_track_sites(z_track_site *out, size_t cap);
+
+// Human-readable summary: totals, histogram and the busiest call sites.
+void z_track_report(FILE *f);
+
+// Prints the counters of `after - before` (e.g. around one request).
+void z_track_report_diff(FILE *f, const z_track_stats *before, const z_track_stats *after);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZTRACK_H
+
+#ifdef ZTRACK_IMPLEMENTATION
+#ifndef ZTRACK_IMPLEMENTATION_DONE
+#define ZTRACK_IMPLEMENTATION_DONE
+
+#ifndef Z_TRACK_BASE_MALLOC
+#   define Z_TRACK_BASE_MALLOC(sz)      malloc(sz)
+#   define Z_TRACK_BASE_REALLOC(p, sz)  realloc(p, sz)
+#   define Z_TRACK_BASE_FREE(p)         free(p)
+#endif
+
+// Call-site slots per thread; extra sites are folded into one overflow slot.
+#ifndef ZTRACK_SITES
+#   define ZTRACK_SITES 512
+#endif
+
+// Sites printed by z_track_report.
+#ifndef ZTRACK_REPORT_TOP
+#   define ZTRACK_REPORT_TOP 20
+#endif
+
+/* * Per-thread counters have a single writer, so a relaxed load + store is
+ * enough and avoids locked instructions on the hot path.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#   define ZTRACK_LOAD_(x)      __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#   define ZTRACK_BUMP_(x, d)   __atomic_store_n(&(x), ZTRACK_LOAD_(x) + (d), __ATOMIC_RELAXED)
+#   define ZTRACK_XADD_(x, d)   (__atomic_add_fetch(&(x), (d), __ATOMIC_RELAXED))
+#else
+    // No atomics available: counters are only exact for single-threaded programs.
+#   define ZTRACK_LOAD_(x)      (x)
+#   define ZTRACK_BUMP_(x, d)   ((x) += (d))
+#   define ZTRACK_XADD_(x, d)   ((x) += (d))
+#endif
+
+typedef struct ztrack_hdr_ {
+    size_t size;
+    const char *file;
+    int line;
+} ztrack_hdr_;
+
+#define ZTRACK_HDR_SIZE_ (((sizeof(ztrack_hdr_) + Z_MAX_ALIGN - 1) / Z_MAX_ALIGN) * Z_MAX_ALIGN)
+
+typedef struct ztrack_thread_ {
+    struct ztrack_thread_ *next;
+    z_track_stats stats;
+    z_track_site sites[ZTRACK_SITES + 1];   // Last slot is the overflow bucket.
+} ztrack_thread_;
+
+static ztrack_thread_ *ztrack_threads_ = NULL;
+static int64_t ztrack_live_ = 0;
+static int64_t ztrack_peak_ = 0;
+static Z_THREAD_LOCAL ztrack_thread_ *ztrack_self_ = NULL;
+
+static ztrack_thread_ *ztrack_self_get_(void)
+{
+    ztrack_thread_ *t = ztrack_self_;
+    if (Z_LIKELY(NULL != t))
+    {
+        return t;
+    }
+    t = (ztrack_thread_ *)Z_TRACK_BASE_MALLOC(sizeof(ztrack_thread_));
+    if (!t)
+    {
+        return NULL;
+    }
+    memset(t, 0, sizeof(*t));
+    t->sites[ZTRACK_SITES].file = "<other>";
+    // Thread records are never freed so their counters survive thread exit.
+#if defined(__GNUC__) || defined(__clang__)
+    t->next = __atomic_load_n(&ztrack_threads_, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ztrack_threads_, &t->next, t, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+#else
+    t->next = ztrack_threads_;
+    ztrack_threads_ = t;
+#endif
+    ztrack_self_ = t;
+    return t;
+}
+
+static size_t ztrack_bucket_(size_t size)
+{
+    size_t b = 0;
+    while (size && b < Z_TRACK_BUCKETS - 1)
+    {
+        size >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static z_track_site *ztrack_site_(ztrack_thread_ *t, const char *file, int line)
+{
+    size_t h = (((uintptr_t)file >> 3) * 31u + (size_t)line) % ZTRACK_SITES;
+    for (size_t probe = 0; probe < ZTRACK_SITES; probe++)
+    {
+        z_track_site *s = &t->sites[(h + probe) % ZTRACK_SITES];
+        if (s->file == file && s->line == line)
+        {
+            return s;
+        }
+        if (NULL == s->file)
+        {
+            s->line = line;
+#if defined(__GNUC__) || defined(__clang__)
+            __atomic_store_n(&s->file, file, __ATOMIC_RELEASE);
+#else
+            s->file = file;
+#endif
+            return s;
+        }
+    }
+    return &t->sites[ZTRACK_SITES];
+}
+
+static void ztrack_live_add_(int64_t delta)
+{
+    int64_t live = ZTRACK_XADD_(ztrack_live_, delta);
+#if defined(__GNUC__) || defined(__clang__)
+    int64_t peak = __atomic_load_n(&ztrack_peak_, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&ztrack_peak_, &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+#else
+    if (live > ztrack_peak_)
+    {
+        ztrack_peak_ = live;
+    }
+#endif
+}
+
+// Records a new or resized block of `size` bytes at file:line.
+static void ztrack_record_(ztrack_thread_ *t, bool is_realloc, size_t size, const char *file, int line)
+{
+    z_track_site *s = ztrack_site_(t, file, line);
+    if (is_realloc)
+    {
+        ZTRACK_BUMP_(t->stats.reallocs, 1);
+        ZTRACK_BUMP_(s->reallocs, 1);
+    }
+    else
+    {
+        ZTRACK_BUMP_(t->stats.allocs, 1);
+        ZTRACK_BUMP_(s->allocs, 1);
+    }
+    ZTRACK_BUMP_(t->stats.bytes_requested, size);
+    ZTRACK_BUMP_(s->bytes_requested, size);
+    ZTRACK_BUMP_(t->stats.live_bytes, (int64_t)size);
+    ZTRACK_BUMP_(s->live_bytes, (int64_t)size);
+    ZTRACK_BUMP_(t->stats.histogram[ztrack_bucket_(size)], 1);
+    ztrack_live_add_((int64_t)size);
+}
+
+// Forgets a block; charged to the site that last (re)allocated it.
+static void ztrack_forget_(ztrack_thread_ *t, const ztrack_hdr_ *h, bool count_free)
+{
+    z_track_site *s = ztrack_site_(t, h->file, h->line);
+    if (count_free)
+    {
+        ZTRACK_BUMP_(t->stats.frees, 1);
+        ZTRACK_BUMP_(s->frees, 1);
+    }
+    ZTRACK_BUMP_(t->stats.live_bytes, -(int64_t)h->size);
+    ZTRACK_BUMP_(s->live_bytes, -(int64_t)h->size);
+    ztrack_live_add_(-(int64_t)h->size);
+}
+
+static void *ztrack_finish_(char *raw, size_t size, const char *file, int line)
+{
+    ztrack_hdr_ *h = (ztrack_hdr_ *)raw;
+    h->size = size;
+    h->file = file;
+    h->line = line;
+    return raw + ZTRACK_HDR_SIZE_;
+}
+
+void *z_track_malloc(size_t size, const char *file, int line)
+{
+    ztrack_thread_ *t = ztrack_self_get_();
+    if (!t || size > (size_t)-1 - ZTRACK_HDR_SIZE_)
+    {
+        return NULL;
+    }
+    char *raw = (char *)Z_TRACK_BASE_MALLOC(ZTRACK_HDR_SIZE_ + size);
+    if (!raw)
+    {
+        return NULL;
+    }
+    ztrack_record_(t, false, size, file, line);
+    return ztrack_finish_(raw, size, file, line);
+}
+
+void *z_track_calloc(size_t n, size_t size, const char *file, int line)
+{
+    if (n && size > (size_t)-1 / n)
+    {
+        return NULL;
+    }
+    void *p = z_track_malloc(n * size, file, line);
+    if (p)
+    {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+void *z_track_realloc(void *ptr, size_t size, const char *file, int line)
+{
+    if (!ptr)
+    {
+        return z_track_malloc(size, file, line);
+    }
+    ztrack_thread_ *t = ztrack_self_get_();
+    if (!t || size > (size_t)-1 - ZTRACK_HDR_SIZE_)
+    {
+        return NULL;
+    }
+    char *old_raw = (char *)ptr - ZTRACK_HDR_SIZE_;
+    ztrack_hdr_ old = *(ztrack_hdr_ *)old_raw;
+    char *raw = (char *)Z_TRACK_BASE_REALLOC(old_raw, ZTRACK_HDR_SIZE_ + size);
+    if (!raw)
+    {
+        return NULL;
+    }
+    ztrack_forget_(t, &old, false);
+    ztrack_record_(t, true, size, file, line);
+    return ztrack_finish_(raw, size, file, line);
+}
+
+void z_track_free(void *ptr, const char *file, int line)
+{
+    (void)file; (void)line;
+    if (!ptr)
+    {
+        return;
+    }
+    char *raw = (char *)ptr - ZTRACK_HDR_SIZE_;
+    ztrack_thread_ *t = ztrack_self_get_();
+    if (t)
+    {
+        ztrack_forget_(t, (ztrack_hdr_ *)raw, true);
+    }
+    Z_TRACK_BASE_FREE(raw);
+}
+
+static ztrack_thread_ *ztrack_first_(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&ztrack_threads_, __ATOMIC_ACQUIRE);
+#else
+    return ztrack_threads_;
+#endif
+}
+
+void z_track_snapshot(z_track_stats *out)
+{
+    memset(out, 0, sizeof(*out));
+    for (ztrack_thread_ *t = ztrack_first_(); t; t = t->next)
+    {
+        out->allocs          += ZTRACK_LOAD_(t->stats.allocs);
+        out->reallocs        += ZTRACK_LOAD_(t->stats.reallocs);
+        out->frees           += ZTRACK_LOAD_(t->stats.frees);
+        out->bytes_requested += ZTRACK_LOAD_(t->stats.bytes_requested);
+        out->live_bytes      += ZTRACK_LOAD_(t->stats.live_bytes);
+        for (size_t i = 0; i < Z_TRACK_BUCKETS; i++)
+        {
+            out->histogram[i] += ZTRACK_LOAD_(t->stats.histogram[i]);
+        }
+    }
+    out->peak_bytes = ZTRACK_LOAD_(ztrack_peak_);
+}
+
+void z_track_diff(const z_track_stats *before, const z_track_stats *after, z_track_stats *out)
+{
+    out->allocs          = after->allocs - before->allocs;
+    out->reallocs        = after->reallocs - before->reallocs;
+    out->frees           = after->frees - before->frees;
+    out->bytes_requested = after->bytes_requested - before->bytes_requested;
+    out->live_bytes      = after->live_bytes - before->live_bytes;
+    out->peak_bytes      = after->peak_bytes;
+    for (size_t i = 0; i < Z_TRACK_BUCKETS; i++)
+    {
+        out->histogram[i] = after->histogram[i] - before->histogram[i];
+    }
+}
+
+static int ztrack_cmp_key_(const void *a, const void *b)
+{
+    const z_track_site *x = (const z_track_site *)a;
+    const z_track_site *y = (const z_track_site *)b;
+    int c = strcmp(x->file, y->file);
+    return c ? c : (x->line > y->line) - (x->line < y->line);
+}
+
+static int ztrack_cmp_live_(const void *a, const void *b)
+{
+    const z_track_site *x = (const z_track_site *)a;
+    const z_track_site *y = (const z_track_site *)b;
+    if (x->live_bytes != y->live_bytes)
+    {
+        return (x->live_bytes < y->live_bytes) ? 1 : -1;
+    }
+    return (x->reallocs < y->reallocs) - (x->reallocs > y->reallocs);
+}
+
+size_t z_track_sites(z_track_site *out, size_t cap)
+{
+    size_t total = 0;
+    for (ztrack_thread_ *t = ztrack_first_(); t; t = t->next)
+    {
+        total += ZTRACK_SITES + 1;
+    }
+    if (0 == total)
+    {
+        return 0;
+    }
+    z_track_site *all = (z_track_site *)Z_TRACK_BASE_MALLOC(total * sizeof(z_track_site));
+    if (!all)
+    {
+        return 0;
+    }
+
+    size_t n = 0;
+    for (ztrack_thread_ *t = ztrack_first_(); t; t = t->next)
+    {
+        for (size_t i = 0; i <= ZTRACK_SITES; i++)
+        {
+            const z_track_site *s = &t->sites[i];
+#if defined(__GNUC__) || defined(__clang__)
+            const char *file = __atomic_load_n(&s->file, __ATOMIC_ACQUIRE);
+#else
+            const char *file = s->file;
+#endif
+            if (!file)
+            {
+                continue;
+            }
+            z_track_site *d = &all[n++];
+            d->file            = file;
+            d->line            = s->line;
+            d->allocs          = ZTRACK_LOAD_(s->allocs);
+            d->reallocs        = ZTRACK_LOAD_(s->reallocs);
+            d->frees           = ZTRACK_LOAD_(s->frees);
+            d->bytes_requested = ZTRACK_LOAD_(s->bytes_requested);
+            d->live_bytes      = ZTRACK_LOAD_(s->live_bytes);
+            if (0 == d->allocs && 0 == d->reallocs && 0 == d->frees)
+            {
+                n--;   // Unused overflow slot.
+            }
+        }
+    }
+
+    // The same site can appear once per thread (and once per TU copy of __FILE__).
+    qsort(all, n, sizeof(*all), ztrack_cmp_key_);
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (m > 0 && 0 == ztrack_cmp_key_(&all[m - 1], &all[i]))
+        {
+            all[m - 1].allocs          += all[i].allocs;
+            all[m - 1].reallocs        += all[i].reallocs;
+            all[m - 1].frees           += all[i].frees;
+            all[m - 1].bytes_requested += all[i].bytes_requested;
+            all[m - 1].live_bytes      += all[i].live_bytes;
+        }
+        else
+        {
+            all[m++] = all[i];
+        }
+    }
+    qsort(all, m, sizeof(*all), ztrack_cmp_live_);
+
+    if (out && cap)
+    {
+        memcpy(out, all, (m < cap ? m : cap) * sizeof(*all));
+    }
+    Z_TRACK_BASE_FREE(all);
+    return m;
+}
+
+static void ztrack_print_stats_(FILE *f, const z_track_stats *s)
+{
+    fprintf(f, "  allocs:    %llu\n", (unsigned long long)s->allocs);
+    fprintf(f, "  reallocs:  %llu\n", (unsigned long long)s->reallocs);
+    fprintf(f, "  frees:     %llu\n", (unsigned long long)s->frees);
+    fprintf(f, "  requested: %llu bytes\n", (unsigned long long)s->bytes_requested);
+    fprintf(f, "  live:      %lld bytes\n", (long long)s->live_bytes);
+    fprintf(f, "  peak:      %lld bytes\n", (long long)s->peak_bytes);
+    fprintf(f, "  size histogram:\n");
+    for (size_t i = 0; i < Z_TRACK_BUCKETS; i++)
+    {
+        if (0 == s->histogram[i])
+        {
+            continue;
+        }
+        if (0 == i)
+        {
+            fprintf(f, "    %10s  %llu\n", "0", (unsigned long long)s->histogram[i]);
+        }
+        else
+        {
+            fprintf(f, "    < 2^%-6u  %llu\n", (unsigned)i, (unsigned long long)s->histogram[i]);
+        }
+    }
+}
+
+void z_track_report(FILE *f)
+{
+    z_track_stats s;
+    z_track_snapshot(&s);
+    fprintf(f, "z-track report\n");
+    ztrack_print_stats_(f, &s);
+
+    z_track_site top[ZTRACK_REPORT_TOP];
+    size_t n = z_track_sites(top, ZTRACK_REPORT_TOP);
+    if (n > ZTRACK_REPORT_TOP)
+    {
+        n = ZTRACK_REPORT_TOP;
+    }
+    fprintf(f, "  call sites (by live bytes):\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        fprintf(f, "    %s:%d  live=%lld allocs=%llu reallocs=%llu frees=%llu requested=%llu\n",
+                top[i].file, top[i].line, (long long)top[i].live_bytes,
+                (unsigned long long)top[i].allocs, (unsigned long long)top[i].reallocs,
+                (unsigned long long)top[i].frees, (unsigned long long)top[i].bytes_requested);
+    }
+}
+
+void z_track_report_diff(FILE *f, const z_track_stats *before, const z_track_stats *after)
+{
+    z_track_stats d;
+    z_track_diff(before, after, &d);
+    fprintf(f, "z-track diff\n");
+    ztrack_print_stats_(f, &d);
+}
+
+#endif // ZTRACK_IMPLEMENTATION_DONE
+#endif // ZTRACK_IMPLEMENTATION
@@ -0,0 +1,345 @@
+/*
+ * zvmem.h — Reserve/commit virtual memory buffers for the Zen Development Kit (ZDK)
+ * Part of ZDK
+ *
+ * A z_vbuf reserves a large range of address space up front and commits
+ * pages only as the buffer grows. Growth never copies and `data` never
+ * moves while the reservation lasts, so very large vectors and string
+ * builders avoid the realloc copy (and the latency spike) when they double.
+ *
+ * If a buffer outgrows its reservation, Linux falls back to mremap, which
+ * moves page tables instead of bytes (`data` may change in that case).
+ * Platforms without virtual memory APIs fall back to Z_REALLOC.
+ *
+ * Containers typically keep using Z_MALLOC while small and switch to a
+ * z_vbuf once they cross Z_VBUF_THRESHOLD (see z_vbuf_init_copy).
+ *
+ * Define ZVMEM_IMPLEMENTATION in exactly one translation unit before
+ * including this header.
+ *
+ * License: MIT
+ * Author: Zuhaitz
+ * Repository: https://github.com/z-libs/z-core
+ * Version: 1.0.0
+ */
+
+#ifndef ZVMEM_H
+#define ZVMEM_H
+
+#include "zcommon.h"
+
+#if defined(_WIN32)
+#   define Z_HAS_VMEM 1
+#elif defined(__unix__) || defined(__APPLE__)
+#   define Z_HAS_VMEM 1
+#else
+#   define Z_HAS_VMEM 0
+#endif
+
+// Size at which containers should move their storage into a z_vbuf.
+#ifndef Z_VBUF_THRESHOLD
+#   define Z_VBUF_THRESHOLD ((size_t)64 << 20)
+#endif
+
+// Default reservation when z_vbuf_init is given 0 (address space only).
+#ifndef Z_VBUF_DEFAULT_RESERVE
+#   if UINTPTR_MAX > 0xFFFFFFFFu
+#       define Z_VBUF_DEFAULT_RESERVE ((size_t)64 << 30)
+#   else
+#       define Z_VBUF_DEFAULT_RESERVE ((size_t)256 << 20)
+#   endif
+#endif
+
+typedef struct z_vbuf {
+    char *data;
+    size_t committed;   // Bytes readable/writable from `data`.
+    size_t reserved;    // Bytes of address space held from `data`.
+} z_vbuf;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reserves `reserve` bytes (rounded to pages; 0 = Z_VBUF_DEFAULT_RESERVE).
+int z_vbuf_init(z_vbuf *b, size_t reserve);
+
+/* * Reserves like z_vbuf_init and copies `len` bytes from `src` in once.
+ * The caller still owns (and frees) `src`.
+ */
+int z_vbuf_init_copy(z_vbuf *b, size_t reserve, const void *src, size_t len);
+
+/* * Ensures at least `bytes` are committed. Returns Z_OK, or Z_ENOMEM if the
+ * system refuses the commit or the reservation cannot be extended.
+ */
+int z_vbuf_commit(z_vbuf *b, size_t bytes);
+
+// Returns pages beyond `bytes` to the system. The reservation is kept.
+void z_vbuf_shrink(z_vbuf *b, size_t bytes);
+
+void z_vbuf_free(z_vbuf *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Fast path: only calls into the system when a new page is needed.
+static inline int z_vbuf_ensure(z_vbuf *b, size_t bytes)
+{
+    return Z_LIKELY(bytes <= b->committed) ? Z_OK : z_vbuf_commit(b, bytes);
+}
+
+#endif // ZVMEM_H
+
+#ifdef ZVMEM_IMPLEMENTATION
+#ifndef ZVMEM_IMPLEMENTATION_DONE
+#define ZVMEM_IMPLEMENTATION_DONE
+
+#if defined(_WIN32)
+#   include <windows.h>
+#elif Z_HAS_VMEM
+    // mremap needs _GNU_SOURCE before the first system header; otherwise it is skipped.
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#       define MAP_ANONYMOUS MAP_ANON
+#   endif
+#   ifndef MAP_ANONYMOUS
+#       error "zvmem.h: anonymous mmap is hidden; build this unit with _DEFAULT_SOURCE or a gnu C mode."
+#   endif
+#   ifndef MAP_NORESERVE
+#       define MAP_NORESERVE 0
+#   endif
+#endif
+
+static size_t zvmem_page_(void)
+{
+    static size_t page = 0;
+    if (0 == page)
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        page = (size_t)si.dwPageSize;
+#elif Z_HAS_VMEM
+        long p = sysconf(_SC_PAGESIZE);
+        page = (p > 0) ? (size_t)p : 4096;
+#else
+        page = Z_GROWTH_PAGE;
+#endif
+    }
+    return page;
+}
+
+static size_t zvmem_round_(size_t bytes, size_t page)
+{
+    if (bytes > (size_t)-1 - (page - 1))
+    {
+        return 0;
+    }
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+int z_vbuf_init(z_vbuf *b, size_t reserve)
+{
+    size_t page = zvmem_page_();
+    b->data = NULL;
+    b->committed = 0;
+    b->reserved = 0;
+    reserve = zvmem_round_(reserve ? reserve : Z_VBUF_DEFAULT_RESERVE, page);
+    if (0 == reserve)
+    {
+        return Z_EINVAL;
+    }
+#if defined(_WIN32)
+    void *p = VirtualAlloc(NULL, reserve, MEM_RESERVE, PAGE_NOACCESS);
+    if (!p)
+    {
+        return Z_ENOMEM;
+    }
+#elif Z_HAS_VMEM
+    void *p = mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == p)
+    {
+        return Z_ENOMEM;
+    }
+#else
+    // Heap fallback: nothing to reserve, commit goes through Z_REALLOC.
+    void *p = NULL;
+#endif
+    b->data = (char *)p;
+    b->reserved = reserve;
+    return Z_OK;
+}
+
+int z_vbuf_init_copy(z_vbuf *b, size_t reserve, const void *src, size_t len)
+{
+    int rc = z_vbuf_init(b, reserve > len ? reserve : len);
+    if (Z_OK != rc)
+    {
+        return rc;
+    }
+    rc = z_vbuf_commit(b, len);
+    if (Z_OK != rc)
+    {
+        z_vbuf_free(b);
+        return rc;
+    }
+    if (len)
+    {
+        memcpy(b->data, src, len);
+    }
+    return Z_OK;
+}
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+/* * Grows the reservation by moving page tables; the data is not copied.
+ * The new range is reserved first and the committed head moved into it, so
+ * no part of the buffer is ever unmapped while another thread could map
+ * over it, and the extension is never charged as read/write memory.
+ */
+static int zvmem_remap_(z_vbuf *b, size_t new_reserve)
+{
+    void *p = mmap(NULL, new_reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == p)
+    {
+        return Z_ENOMEM;
+    }
+    if (b->committed &&
+        MAP_FAILED == mremap(b->data, b->committed, b->committed, MREMAP_MAYMOVE | MREMAP_FIXED, p))
+    {
+        munmap(p, new_reserve);
+        return Z_ENOMEM;
+    }
+    // The head has left the old range; only its reserved tail remains.
+    if (b->reserved > b->committed)
+    {
+        munmap(b->data + b->committed, b->reserved - b->committed);
+    }
+    b->data = (char *)p;
+    b->reserved = new_reserve;
+    return Z_OK;
+}
+#endif
+
+int z_vbuf_commit(z_vbuf *b, size_t bytes)
+{
+    if (bytes <= b->committed)
+    {
+        return Z_OK;
+    }
+    Z_TRACE_SCOPE("z_vbuf_commit");
+    size_t page = zvmem_page_();
+
+    // Commit ahead with the shared growth policy to keep syscalls rare.
+    size_t target = zvmem_round_(z_grow_capacity(b->committed, bytes, 1, page), page);
+    if (0 == target)
+    {
+        return Z_ENOMEM;
+    }
+
+#if Z_HAS_VMEM
+    if (target > b->reserved)
+    {
+        target = zvmem_round_(bytes, page);
+        if (0 == target)
+        {
+            return Z_ENOMEM;
+        }
+        if (target > b->reserved)
+        {
+#   if defined(__linux__) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+            size_t grown = z_grow_capacity(b->reserved, target, 1, 0);
+            if (0 == grown || Z_OK != zvmem_remap_(b, zvmem_round_(grown, page)))
+            {
+                return Z_ENOMEM;
+            }
+#   else
+            return Z_ENOMEM;
+#   endif
+        }
+    }
+    size_t delta = target - b->committed;
+#   if defined(_WIN32)
+    if (!VirtualAlloc(b->data + b->committed, delta, MEM_COMMIT, PAGE_READWRITE))
+    {
+        return Z_ENOMEM;
+    }
+#   else
+    if (0 != mprotect(b->data + b->committed, delta, PROT_READ | PROT_WRITE))
+    {
+        return Z_ENOMEM;
+    }
+#   endif
+#else
+    char *p = (char *)Z_REALLOC(b->data, target);
+    if (!p)
+    {
+        return Z_ENOMEM;
+    }
+    b->data = p;
+    b->reserved = target;
+#endif
+    b->committed = target;
+    return Z_OK;
+}
+
+void z_vbuf_shrink(z_vbuf *b, size_t bytes)
+{
+    size_t keep = zvmem_round_(bytes, zvmem_page_());
+    if (0 == keep && bytes)
+    {
+        return;
+    }
+    if (keep >= b->committed)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    VirtualFree(b->data + keep, b->committed - keep, MEM_DECOMMIT);
+#elif Z_HAS_VMEM
+    // Replacing the range drops its pages immediately on every POSIX system.
+    mmap(b->data + keep, b->committed - keep, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#else
+    if (keep)
+    {
+        char *p = (char *)Z_REALLOC(b->data, keep);
+        if (p)
+        {
+            b->data = p;
+            b->reserved = keep;
+        }
+        else
+        {
+            return;
+        }
+    }
+    else
+    {
+        Z_FREE(b->data);
+        b->data = NULL;
+        b->reserved = 0;
+    }
+#endif
+    b->committed = keep;
+}
+
+void z_vbuf_free(z_vbuf *b)
+{
+    if (b->data)
+    {
+#if defined(_WIN32)
+        VirtualFree(b->data, 0, MEM_RELEASE);
+#elif Z_HAS_VMEM
+        munmap(b->data, b->reserved);
+#else
+        Z_FREE(b->data);
+#endif
+    }
+    b->data = NULL;
+    b->committed = 0;
+    b->reserved = 0;
+}
+
+#endif // ZVMEM_IMPLEMENTATION_DONE
+#endif // ZVMEM_IMPLEMENTATION